@@ -46,6 +46,9 @@ void FeatureBlockLogisticRegression::init()
 	m_regularization=0;
 	m_tolerance=1e-3;
 	m_max_iter=1000;
+	m_num_threads=1;
+	m_path_size=1;
+	m_path_ratio=0.01;
 }
 
 FeatureBlockLogisticRegression::~FeatureBlockLogisticRegression()
@@ -65,6 +68,9 @@ void FeatureBlockLogisticRegression::register_parameters()
 		ParameterProperties::HYPER);
 	SG_ADD(&m_max_iter, "max_iter", "maximum number of iterations",
 		ParameterProperties::HYPER);
+	SG_ADD(&m_num_threads, "num_threads", "number of threads");
+	SG_ADD(&m_path_size, "path_size", "number of regularization path values");
+	SG_ADD(&m_path_ratio, "path_ratio", "ratio of the smallest and the largest z of the path");
 }
 
 std::shared_ptr<IndexBlockRelation> FeatureBlockLogisticRegression::get_feature_relation() const
@@ -107,6 +113,26 @@ float64_t FeatureBlockLogisticRegression::get_q() const
 	return m_q;
 }
 
+int32_t FeatureBlockLogisticRegression::get_num_threads() const
+{
+	return m_num_threads;
+}
+
+int32_t FeatureBlockLogisticRegression::get_path_size() const
+{
+	return m_path_size;
+}
+
+float64_t FeatureBlockLogisticRegression::get_path_ratio() const
+{
+	return m_path_ratio;
+}
+
+SGVector<float64_t> FeatureBlockLogisticRegression::get_path_z() const
+{
+	return slep_z_path(m_z, m_path_ratio, m_path_size);
+}
+
 void FeatureBlockLogisticRegression::set_max_iter(int32_t max_iter)
 {
 	ASSERT(max_iter>=0)
@@ -141,6 +167,31 @@ void FeatureBlockLogisticRegression::set_q(float64_t q)
 	m_q = q;
 }
 
+void FeatureBlockLogisticRegression::set_num_threads(int32_t num_threads)
+{
+	require(num_threads > 0, "Number of threads must be positive");
+	m_num_threads = num_threads;
+}
+
+void FeatureBlockLogisticRegression::set_path_size(int32_t path_size)
+{
+	ASSERT(path_size>0)
+	m_path_size = path_size;
+}
+
+void FeatureBlockLogisticRegression::set_path_ratio(float64_t path_ratio)
+{
+	ASSERT(path_ratio>0.0 && path_ratio<=1.0)
+	m_path_ratio = path_ratio;
+}
+
+void FeatureBlockLogisticRegression::select_path_solution(int32_t i)
+{
+	require(i>=0 && i<(int32_t)m_path_w.size(), "Path solution {} is not available", i);
+	set_w(m_path_w[i]);
+	set_bias(m_path_bias[i]);
+}
+
 bool FeatureBlockLogisticRegression::train_machine(const std::shared_ptr<DotFeatures>& features,
 	 const std::shared_ptr<Labels>& labs)
 {
@@ -155,44 +206,38 @@ bool FeatureBlockLogisticRegression::train_machine(const std::shared_ptr<DotFeat
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.loss = LOGISTIC;
 
+	SGVector<index_t> ind;
+	SGVector<float64_t> gWeight;
+	SGVector<float64_t> ind_t;
+	SGVector<float64_t> G;
 	EIndexBlockRelationType relation_type = m_feature_relation->get_relation_type();
 	switch (relation_type)
 	{
 		case GROUP:
 		{
 			auto feature_group = m_feature_relation->as<IndexBlockGroup>();
-			SGVector<index_t> ind = feature_group->get_SLEP_ind();
+			ind = feature_group->get_SLEP_ind();
 			options.ind = ind.vector;
 			options.n_feature_blocks = ind.vlen-1;
 			if (ind[ind.vlen-1] > features->get_dim_feature_space())
 				error("Group of features covers more features than available");
 
-			options.gWeight = SG_MALLOC(double, options.n_feature_blocks);
-			for (int32_t i=0; i<options.n_feature_blocks; i++)
-				options.gWeight[i] = 1.0;
+			gWeight = SGVector<float64_t>(options.n_feature_blocks);
+			gWeight.set_const(1.0);
+			options.gWeight = gWeight.vector;
 			options.mode = FEATURE_GROUP;
 			options.loss = LOGISTIC;
 			options.n_nodes = 0;
-			slep_result_t result = slep_solver(features, y.vector, m_z, options);
-
-			SG_FREE(options.gWeight);
-			int32_t n_feats = features->get_dim_feature_space();
-			SGVector<float64_t> new_w(n_feats);
-			for (int i=0; i<n_feats; i++)
-				new_w[i] = result.w[i];
-			set_bias(result.c[0]);
-
-			set_w(new_w);
 		}
 		break;
 		case TREE:
 		{
 			auto feature_tree = m_feature_relation->as<IndexBlockTree>();
 
-			SGVector<float64_t> ind_t = feature_tree->get_SLEP_ind_t();
-			SGVector<float64_t> G;
+			ind_t = feature_tree->get_SLEP_ind_t();
 			if (feature_tree->is_general())
 			{
 				G = feature_tree->get_SLEP_G();
@@ -204,23 +249,40 @@ bool FeatureBlockLogisticRegression::train_machine(const std::shared_ptr<DotFeat
 			options.n_feature_blocks = ind_t.vlen/3;
 			options.mode = FEATURE_TREE;
 			options.loss = LOGISTIC;
-
-			slep_result_t result = slep_solver(features, y.vector, m_z, options);
-
-			int32_t n_feats = features->get_dim_feature_space();
-			SGVector<float64_t> new_w(n_feats);
-			for (int i=0; i<n_feats; i++)
-				new_w[i] = result.w[i];
-
-			set_bias(result.c[0]);
-
-			set_w(new_w);
 		}
 		break;
 		default:
 			error("Not supported feature relation type");
 	}
 
+	int32_t n_feats = features->get_dim_feature_space();
+	m_path_w.clear();
+	m_path_bias.clear();
+	if (m_path_size>1)
+	{
+		std::vector<slep_result_t> path = slep_solver_path(features, y.vector, get_path_z(), options);
+		for (const auto& result : path)
+		{
+			SGVector<float64_t> path_w(n_feats);
+			for (int i=0; i<n_feats; i++)
+				path_w[i] = result.w[i];
+			m_path_w.push_back(path_w);
+			m_path_bias.push_back(result.c[0]);
+		}
+		select_path_solution(m_path_size-1);
+	}
+	else
+	{
+		slep_result_t result = slep_solver(features, y.vector, m_z, options);
+
+		SGVector<float64_t> new_w(n_feats);
+		for (int i=0; i<n_feats; i++)
+			new_w[i] = result.w[i];
+		set_bias(result.c[0]);
+
+		set_w(new_w);
+	}
+
 	return true;
 }
 
@@ -15,6 +15,8 @@
 #include <shogun/lib/IndexBlockRelation.h>
 #include <shogun/machine/LinearMachine.h>
 
+#include <vector>
+
 namespace shogun
 {
 /** @brief class FeatureBlockLogisticRegression, a linear
@@ -82,6 +84,14 @@ class FeatureBlockLogisticRegression : public LinearMachine
 		float64_t get_tolerance() const;
 		/** get z */
 		float64_t get_z() const;
+		/** get number of threads */
+		int32_t get_num_threads() const;
+		/** get path size */
+		int32_t get_path_size() const;
+		/** get path ratio */
+		float64_t get_path_ratio() const;
+		/** get z values of the regularization path */
+		SGVector<float64_t> get_path_z() const;
 
 		/** set max iter */
 		void set_max_iter(int32_t max_iter);
@@ -95,6 +105,18 @@ class FeatureBlockLogisticRegression : public LinearMachine
 		void set_tolerance(float64_t tolerance);
 		/** set z */
 		void set_z(float64_t z);
+		/** set number of threads of the SLEP solver */
+		void set_num_threads(int32_t num_threads);
+		/** set number of z values on the regularization path from z
+		 * down to z*path_ratio, each warm started from the previous one
+		 * with feature blocks screened by the strong rule (group
+		 * relations only); the model is the one of the smallest z
+		 */
+		void set_path_size(int32_t path_size);
+		/** set ratio of the smallest and the largest z of the path */
+		void set_path_ratio(float64_t path_ratio);
+		/** set the model to the solution for the i-th path value */
+		void select_path_solution(int32_t i);
 
 	protected:
 
@@ -134,6 +156,21 @@ class FeatureBlockLogisticRegression : public LinearMachine
 		/** regularization coefficient */
 		float64_t m_z;
 
+		/** number of threads */
+		int32_t m_num_threads;
+
+		/** number of regularization path values */
+		int32_t m_path_size;
+
+		/** ratio of the smallest and the largest z of the path */
+		float64_t m_path_ratio;
+
+		/** weights along the regularization path */
+		std::vector<SGVector<float64_t>> m_path_w;
+
+		/** biases along the regularization path */
+		std::vector<float64_t> m_path_bias;
+
 };
 }
 #endif //USE_GPL_SHOGUN
@@ -23,11 +23,21 @@ using namespace shogun;
 GPBTSVM::GPBTSVM()
 : SVM(), model(NULL)
 {
+	init();
 }
 
 GPBTSVM::GPBTSVM(float64_t C, std::shared_ptr<Kernel> k, std::shared_ptr<Labels> lab)
 : SVM(C, std::move(k), std::move(lab)), model(NULL)
 {
+	init();
+}
+
+void GPBTSVM::init()
+{
+	m_num_threads=1;
+	m_float32_cache=(sizeof(KERNELCACHE_ELEM) == sizeof(float32_t));
+	SG_ADD(&m_num_threads, "num_threads", "Number of threads used by the solver");
+	SG_ADD(&m_float32_cache, "float32_cache", "Store the cached kernel rows as float32");
 }
 
 GPBTSVM::~GPBTSVM()
@@ -65,6 +75,8 @@ bool GPBTSVM::train_machine(std::shared_ptr<Features> data)
 	prob.c_const = get_C1();
 	prob.chunk_size = get_qpsize();
 	prob.linadd = get_linadd_enabled();
+	prob.nthreads = m_num_threads;
+	prob.float32_cache = m_float32_cache;
 
 	if (prob.chunk_size < 2)      prob.chunk_size = 2;
 	if (prob.q <= 0)              prob.q = prob.chunk_size / 3;
@@ -82,6 +94,7 @@ bool GPBTSVM::train_machine(std::shared_ptr<Features> data)
 	io::info("\tC: {}", prob.c_const);
 	io::info("\tkernel type: {}", prob.ker_type);
 	io::info("\tcache size: {}Mb", prob.maxmw);
+	io::info("\tthreads: {}", prob.nthreads);
 	io::info("\tStopping tolerance: {}", prob.delta);
 
 	//  /*** compute the number of cache rows up to maxmw Mb. ***/
@@ -96,10 +109,15 @@ bool GPBTSVM::train_machine(std::shared_ptr<Features> data)
 
 	/*** compute the problem solution *******************************************/
 	solution = SG_MALLOC(float64_t, prob.ell);
-	prob.gpdtsolve(solution);
+	if (prob.nthreads > 1)
+		prob.pgpdtsolve(solution);
+	else
+		prob.gpdtsolve(solution);
 	/****************************************************************************/
 
 	SVM::set_objective(prob.objective_value);
+	SG_DEBUG("kernel cache: {} hits, {} misses, {} evictions",
+			prob.cache_hits, prob.cache_misses, prob.cache_evictions);
 
 	int32_t num_sv=0;
 	int32_t bsv=0;
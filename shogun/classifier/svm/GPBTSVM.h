@@ -36,6 +36,42 @@ class GPBTSVM : public SVM
 		GPBTSVM(float64_t C, std::shared_ptr<Kernel> k, std::shared_ptr<Labels> lab);
 		~GPBTSVM() override;
 
+		/** set number of threads
+		 *
+		 * With more than one thread the parallel solver pgpdtsolve is used,
+		 * which distributes the kernel evaluations and the gradient updates
+		 * among the threads. The kernel must be safe to evaluate from
+		 * several threads then.
+		 *
+		 * @param num_threads number of threads
+		 */
+		void set_num_threads(int32_t num_threads)
+		{
+			require(num_threads > 0, "Number of threads must be positive!");
+			m_num_threads=num_threads;
+		}
+
+		/** get number of threads
+		 *
+		 * @return number of threads
+		 */
+		int32_t get_num_threads() const { return m_num_threads; }
+
+		/** set kernel cache precision
+		 *
+		 * Storing the cached kernel rows as float32 halves the memory of a
+		 * row, so twice as many rows fit into the cache.
+		 *
+		 * @param float32_cache whether to store the rows as float32
+		 */
+		void set_float32_cache(bool float32_cache) { m_float32_cache=float32_cache; }
+
+		/** get kernel cache precision
+		 *
+		 * @return whether the cached rows are stored as float32
+		 */
+		bool get_float32_cache() const { return m_float32_cache; }
+
 		/** @return object name */
 		const char* get_name() const override { return "GPBTSVM"; }
 
@@ -50,9 +86,19 @@ class GPBTSVM : public SVM
 		 */
 		bool train_machine(std::shared_ptr<Features> data=NULL) override;
 
+	private:
+		/** register parameters */
+		void init();
+
 	protected:
 		/** SVM model */
 		struct svm_model* model;
+
+		/** number of threads used by the solver */
+		int32_t m_num_threads;
+
+		/** store the cached kernel rows as float32 */
+		bool m_float32_cache;
 };
 }
 #endif //USE_GPL_SHOGUN
@@ -21,13 +21,15 @@
 using namespace shogun;
 
 SVMLin::SVMLin()
-: LinearMachine(), C1(1), C2(1), epsilon(1e-5), use_bias(true)
+: LinearMachine(), C1(1), C2(1), epsilon(1e-5), use_bias(true),
+  num_threads(1)
 {
 	init();
 }
 
 SVMLin::SVMLin(float64_t C)
-: LinearMachine(), C1(C), C2(C), epsilon(1e-5), use_bias(true)
+: LinearMachine(), C1(C), C2(C), epsilon(1e-5), use_bias(true),
+  num_threads(1)
 {
 	init();
 }
@@ -48,6 +50,7 @@ void SVMLin::init()
 	    &C2, "C2", "C constant for positively labeled examples.",
 	    ParameterProperties::HYPER);
 	SG_ADD(&epsilon, "epsilon", "Convergence precision.");
+	SG_ADD(&num_threads, "num_threads", "Number of threads.");
 }
 
 bool SVMLin::train_machine(const std::shared_ptr<DotFeatures>& features, 
@@ -89,6 +92,8 @@ bool SVMLin::train_machine(const std::shared_ptr<DotFeatures>& features,
 	else
 		Options.bias=0.0;
 
+	Options.num_threads=num_threads;
+
 	for (int32_t i=0;i<num_vec;i++)
 	{
 		if(train_labels.vector[i]>0)
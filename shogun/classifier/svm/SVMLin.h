@@ -82,6 +82,28 @@ class SVMLin : public LinearMachine
 		 */
 		inline float64_t get_epsilon() { return epsilon; }
 
+		/** set number of threads
+		 *
+		 * The outputs of the active examples and the gradient sums of the
+		 * CGLS, L2-SVM-MFN and TSVM solvers are distributed among the
+		 * threads. The gradient is summed into per-thread buffers which
+		 * are added up in a fixed order, so the result matches the single
+		 * threaded one up to rounding.
+		 *
+		 * @param n number of threads
+		 */
+		inline void set_num_threads(int32_t n)
+		{
+			require(n > 0, "Number of threads must be positive!");
+			num_threads=n;
+		}
+
+		/** get number of threads
+		 *
+		 * @return number of threads
+		 */
+		inline int32_t get_num_threads() { return num_threads; }
+
 		/** @return object name */
 		const char* get_name() const override { return "SVMLin"; }
 
@@ -110,6 +132,9 @@ class SVMLin : public LinearMachine
 
 		/** if bias is used */
 		bool use_bias;
+
+		/** number of threads */
+		int32_t num_threads;
 };
 }
 #endif
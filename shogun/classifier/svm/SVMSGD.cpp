@@ -22,6 +22,7 @@
 
 #include <shogun/classifier/svm/SVMSGD.h>
 
+#include <shogun/features/streaming/StreamingDotFeatures.h>
 #include <shogun/lib/Signal.h>
 #include <shogun/loss/HingeLoss.h>
 #include <shogun/mathematics/Math.h>
@@ -68,19 +69,15 @@ bool SVMSGD::train_machine(const std::shared_ptr<DotFeatures>& features,
 	ASSERT(num_vec==num_train_labels)
 	ASSERT(num_vec>0)
 
+	// w is kept as wscale * v, so that the regularization shrinkage is a
+	// single multiplication instead of a pass over all dimensions
 	SGVector<float64_t> w(features->get_dim_feature_space());
 	w.zero();
+	wscale=1;
 	bias=0;
 
 	float64_t lambda= 1.0/(C1*num_vec);
-
-	// Shift t in order to have a
-	// reasonable initial learning rate.
-	// This assumes |x| \approx 1.
-	float64_t maxw = 1.0 / sqrt(lambda);
-	float64_t typw = sqrt(maxw);
-	float64_t eta0 = typw / Math::max(1.0,-loss->first_derivative(-typw,1));
-	t = 1 / (eta0 * lambda);
+	float64_t eta0 = init_schedule(lambda);
 
 	io::info("lambda={}, epochs={}, eta0={}", lambda, epochs, eta0);
 
@@ -90,31 +87,54 @@ bool SVMSGD::train_machine(const std::shared_ptr<DotFeatures>& features,
 
 	io::info("Training on {} vectors", num_vec);
 
-	ELossType loss_type = loss->get_loss_type();
-	bool is_log_loss = false;
-	if ((loss_type == L_LOGLOSS) || (loss_type == L_LOGLOSSMARGIN))
-		is_log_loss = true;
+	if (num_threads > 1 && averaged)
+		io::warn("Averaged SGD is not supported with several threads, using one thread.");
+
+	// margins of the current mini-batch, computed with the weights at its start
+	SGVector<float64_t> margins(Math::max(batch_size, 1));
+	int64_t n = 0;
+	bool log_loss = is_log_loss();
 
 	for (int32_t e = 0; e < epochs && (!cancel_computation()); e++)
 	{
+		if (num_threads > 1 && !averaged)
+		{
+			train_epoch_hogwild(features, labels, w, lambda);
+			continue;
+		}
+
 		count = skip;
-		for (int32_t i=0; i<num_vec; i++)
+		for (int32_t i=0; i<num_vec; i++, n++)
 		{
-			float64_t eta = 1.0 / (lambda * t);
+			if (averaged && n == avg_start)
+				start_averaging(w);
+
+			float64_t eta = learning_rate(lambda, eta0);
 			float64_t y = labels->get_label(i);
-			float64_t z = y * (features->dot(i, w) + bias);
+			float64_t z;
 
-			if (z < 1 || is_log_loss)
+			if (batch_size > 1)
 			{
-				float64_t etd = -eta * loss->first_derivative(z,1);
-				features->add_to_dense_vec(etd * y / wscale, i, w.vector, w.vlen);
-
-				if (use_bias)
+				int32_t j = i % batch_size;
+				if (j == 0)
 				{
-					if (use_regularized_bias)
-						bias *= 1 - eta * lambda * bscale;
-					bias += etd * y * bscale;
+					features->dense_dot_range(margins.vector, i,
+						Math::min(i + batch_size, num_vec), NULL, w.vector,
+						w.vlen, 0);
+					linalg::scale(margins, margins, wscale);
 				}
+				z = y * (margins[j] + bias);
+			}
+			else
+				z = y * (wscale * features->dot(i, w) + bias);
+
+			float64_t alpha = update(z, y, eta, lambda, log_loss);
+			if (alpha != 0)
+			{
+				features->add_to_dense_vec(alpha, i, w.vector, w.vlen);
+				if (avg_div > 0)
+					features->add_to_dense_vec(-avg_wfrac * alpha, i,
+						avg_u.vector, avg_u.vlen);
 			}
 
 			if (--count <= 0)
@@ -122,19 +142,265 @@ bool SVMSGD::train_machine(const std::shared_ptr<DotFeatures>& features,
 				float64_t r = 1 - eta * lambda * skip;
 				if (r < 0.8)
 					r = pow(1 - eta * lambda, skip);
-				linalg::scale(w, w, r);
+				wscale *= r;
 				count = skip;
+
+				// fold the scale into w before it under- or overflows
+				if (wscale < 1e-9 || wscale > 1e9)
+					renormalize(w);
 			}
+
+			if (avg_div > 0)
+				average(1.0 / (n - avg_start + 2));
 			t++;
 		}
 	}
 
+	finish(w);
+
+	return true;
+}
+
+bool SVMSGD::train_streaming(const std::shared_ptr<StreamingDotFeatures>& features,
+	int64_t num_examples)
+{
+	require(features, "No features given.");
+	require(num_examples > 0, "Number of examples must be positive.");
+
+	features->start_parser();
+
+	SGVector<float64_t> w(Math::max(features->get_dim_feature_space(), 1));
+	w.zero();
+	wscale=1;
+	bias=0;
+
+	float64_t lambda = 1.0/(C1*num_examples);
+	float64_t eta0 = init_schedule(lambda);
+
+	io::info("lambda={}, eta0={}, single pass over a stream", lambda, eta0);
+
+	int64_t n = 0;
+	bool log_loss = is_log_loss();
+	for (; !cancel_computation() && features->get_next_example(); n++)
+	{
+		// the dimension of a sparse stream is only known once it is read
+		int32_t dim = features->get_dim_feature_space();
+		if (dim > w.vlen)
+		{
+			w.resize_vector(dim);
+			if (avg_div > 0)
+				avg_u.resize_vector(dim);
+		}
+
+		if (averaged && n == avg_start)
+			start_averaging(w);
+
+		float64_t eta = learning_rate(lambda, eta0);
+		float64_t y = features->get_label();
+		float64_t z = y * (wscale * features->dense_dot(w.vector, w.vlen) + bias);
+
+		float64_t alpha = update(z, y, eta, lambda, log_loss);
+		if (alpha != 0)
+		{
+			features->add_to_dense_vec(alpha, w.vector, w.vlen);
+			if (avg_div > 0)
+				features->add_to_dense_vec(-avg_wfrac * alpha, avg_u.vector,
+					avg_u.vlen);
+		}
+
+		// without a calibration pass there is no skip, but the decay
+		// costs O(1) anyway
+		wscale *= 1 - eta * lambda;
+		if (wscale < 1e-9)
+			renormalize(w);
+
+		if (avg_div > 0)
+			average(1.0 / (n - avg_start + 2));
+		t++;
+
+		features->release_example();
+	}
+
+	features->end_parser();
+
+	io::info("Trained on {} streamed vectors", n);
+	finish(w);
+
+	return true;
+}
+
+float64_t SVMSGD::init_schedule(float64_t lambda)
+{
+	// Shift t in order to have a
+	// reasonable initial learning rate.
+	// This assumes |x| \approx 1.
+	float64_t maxw = 1.0 / sqrt(lambda);
+	float64_t typw = sqrt(maxw);
+	float64_t eta0 = typw / Math::max(1.0,-loss->first_derivative(-typw,1));
+	t = 1 / (eta0 * lambda);
+
+	avg_u = SGVector<float64_t>();
+	avg_div = 0;
+
+	return eta0;
+}
+
+float64_t SVMSGD::learning_rate(float64_t lambda, float64_t eta0) const
+{
+	// ASGD needs a slower decrease than 1/t, both start at eta0
+	if (averaged)
+		return eta0 / pow(lambda * eta0 * t, 0.75);
+
+	return 1.0 / (lambda * t);
+}
+
+bool SVMSGD::is_log_loss() const
+{
+	ELossType loss_type = loss->get_loss_type();
+	return (loss_type == L_LOGLOSS) || (loss_type == L_LOGLOSSMARGIN);
+}
+
+float64_t SVMSGD::update(float64_t z, float64_t y, float64_t eta, float64_t lambda,
+	bool log_loss)
+{
+	if (z >= 1 && !log_loss)
+		return 0;
+
+	float64_t etd = -eta * loss->first_derivative(z,1);
+
+	if (use_bias)
+	{
+		if (use_regularized_bias)
+			bias *= 1 - eta * lambda * bscale;
+		bias += etd * y * bscale;
+	}
+
+	return etd * y / wscale;
+}
+
+void SVMSGD::start_averaging(const SGVector<float64_t>& w)
+{
+	// the average starts at the current iterate wscale * v
+	avg_u = SGVector<float64_t>(w.vlen);
+	avg_u.zero();
+	avg_wfrac = wscale;
+	avg_div = 1;
+	avg_bias = bias;
+}
+
+void SVMSGD::average(float64_t mu)
+{
+	// a <- (1 - mu) * a + mu * w, w enters a only through avg_wfrac
+	avg_div /= 1 - mu;
+	avg_wfrac += mu * avg_div * wscale;
+	avg_bias = (1 - mu) * avg_bias + mu * bias;
+
+	if (avg_div > 1e5)
+	{
+		linalg::scale(avg_u, avg_u, 1.0 / avg_div);
+		avg_wfrac /= avg_div;
+		avg_div = 1;
+	}
+}
+
+void SVMSGD::finish(SGVector<float64_t>& w)
+{
+	renormalize(w);
+
+	if (avg_div > 0)
+	{
+		linalg::add(avg_u, w, w, 1.0 / avg_div, avg_wfrac / avg_div);
+		bias = avg_bias;
+		avg_u = SGVector<float64_t>();
+		avg_div = 0;
+	}
+
 	float64_t wnorm = linalg::dot(w, w);
 	io::info("Norm: {:.6f}, Bias: {:.6f}", wnorm, bias);
 
 	set_w(w);
+}
 
-	return true;
+void SVMSGD::renormalize(SGVector<float64_t>& w)
+{
+	if (wscale != 1.0)
+	{
+		linalg::scale(w, w, wscale);
+		// keeps the average (u + wfrac * v) / div unchanged
+		avg_wfrac /= wscale;
+		wscale = 1;
+	}
+}
+
+void SVMSGD::train_epoch_hogwild(const std::shared_ptr<DotFeatures>& features,
+	const std::shared_ptr<BinaryLabels>& labels, SGVector<float64_t>& w,
+	float64_t lambda)
+{
+	bool log_loss=is_log_loss();
+	int32_t num_vec=features->get_num_vectors();
+	int32_t n_threads=Math::min(num_threads, num_vec);
+	int32_t shard=(num_vec+n_threads-1)/n_threads;
+	int32_t num_rounds=(shard+skip-1)/skip;
+
+	// the k-th example of a shard is the (k*n_threads)-th of the epoch
+	// as seen by the learning rate schedule
+	const float64_t t0=t;
+	SGVector<float64_t> dbias(n_threads);
+
+	for (int32_t round=0; round<num_rounds; round++)
+	{
+		// wscale and bias only change between rounds
+		const float64_t scale=wscale;
+		const float64_t b0=bias;
+		int32_t done=0;
+
+		#pragma omp parallel for num_threads(n_threads) reduction(+:done)
+		for (int32_t k=0; k<n_threads; k++)
+		{
+			int32_t first=k*shard+round*skip;
+			int32_t last=Math::min(Math::min(first+skip, (k+1)*shard), num_vec);
+			float64_t b=b0;
+
+			for (int32_t i=first; i<last; i++)
+			{
+				float64_t tk=t0+float64_t(i-k*shard)*n_threads+k;
+				float64_t eta=1.0/(lambda*tk);
+				float64_t y=labels->get_label(i);
+				float64_t z=y*(scale*features->dot(i, w)+b);
+
+				if (z<1 || log_loss)
+				{
+					float64_t etd=-eta*loss->first_derivative(z,1);
+					features->add_to_dense_vec(etd*y/scale, i, w.vector, w.vlen);
+
+					if (use_bias)
+					{
+						if (use_regularized_bias)
+							b*=1-eta*lambda*bscale;
+						b+=etd*y*bscale;
+					}
+				}
+			}
+
+			dbias[k]=b-b0;
+			done+=Math::max(last-first, 0);
+		}
+
+		for (int32_t k=0; k<n_threads; k++)
+			bias+=dbias[k];
+
+		// weight decay for all examples of this round
+		float64_t eta=1.0/(lambda*(t0+float64_t(round+1)*skip*n_threads));
+		float64_t r=1-eta*lambda*done;
+		if (r<0.8)
+			r=pow(1-eta*lambda, done);
+		wscale*=r;
+
+		if (wscale<1e-9 || wscale>1e9)
+			renormalize(w);
+	}
+
+	t=t0+num_vec;
 }
 
 void SVMSGD::calibrate(const std::shared_ptr<DotFeatures>& features)
@@ -185,6 +451,13 @@ void SVMSGD::init()
 	epochs=5;
 	skip=1000;
 	count=1000;
+	num_threads=1;
+	averaged=false;
+	avg_start=0;
+	batch_size=1;
+	avg_wfrac=1;
+	avg_div=0;
+	avg_bias=0;
 	use_bias=true;
 
 	use_regularized_bias=false;
@@ -198,6 +471,12 @@ void SVMSGD::init()
 	SG_ADD(&epochs, "epochs", "epochs", ParameterProperties::HYPER);
 	SG_ADD(&skip, "skip", "skip");
 	SG_ADD(&count, "count", "count");
+	SG_ADD(&num_threads, "num_threads", "Number of threads");
+	SG_ADD(
+	    &averaged, "averaged", "Indicates if averaged SGD is used.",
+	    ParameterProperties::SETTING);
+	SG_ADD(&avg_start, "avg_start", "Examples before averaging starts");
+	SG_ADD(&batch_size, "batch_size", "Mini-batch size");
 	SG_ADD(
 	    &use_bias, "use_bias", "Indicates if bias is used.",
 	    ParameterProperties::SETTING);
@@ -32,6 +32,9 @@
 
 namespace shogun
 {
+class BinaryLabels;
+class StreamingDotFeatures;
+
 /** @brief class SVMSGD */
 class SVMSGD : public LinearMachine
 {
@@ -84,6 +87,103 @@ class SVMSGD : public LinearMachine
 		 */
 		inline int32_t get_epochs() { return epochs; }
 
+		/** set number of threads
+		 *
+		 * With more than one thread every epoch is split into disjoint
+		 * shards of examples, one per thread, and the threads update the
+		 * shared weight vector without locking (Hogwild). Each thread
+		 * follows the learning rate schedule of the serial solver for its
+		 * own examples. The weight decay and the bias are synchronized
+		 * every skip examples per thread. On sparse data concurrent
+		 * updates rarely touch the same coordinates, so the result is
+		 * close to the serial one, but it is not deterministic. The
+		 * features must be safe to read from several threads then.
+		 *
+		 * @param n number of threads
+		 */
+		inline void set_num_threads(int32_t n)
+		{
+			require(n > 0, "Number of threads must be positive!");
+			num_threads=n;
+		}
+
+		/** get number of threads
+		 *
+		 * @return number of threads
+		 */
+		inline int32_t get_num_threads() { return num_threads; }
+
+		/** set if averaged SGD shall be used
+		 *
+		 * ASGD returns the average of the iterates (Polyak averaging)
+		 * instead of the last one and uses the learning rate
+		 * eta0 / (1 + lambda * eta0 * t)^0.75. It usually converges in a
+		 * single pass over the data. The average is updated in O(nnz) per
+		 * example like the weights. Not supported in the multithreaded
+		 * mode.
+		 *
+		 * @param enable_averaging if averaged SGD shall be used
+		 */
+		inline void set_averaged(bool enable_averaging) { averaged=enable_averaging; }
+
+		/** check if averaged SGD is used
+		 *
+		 * @return if averaged SGD is used
+		 */
+		inline bool get_averaged() { return averaged; }
+
+		/** set number of examples after which averaging starts
+		 *
+		 * @param start number of examples, 0 averages all iterates
+		 */
+		inline void set_averaging_start(int64_t start)
+		{
+			require(start >= 0, "Averaging start must not be negative!");
+			avg_start=start;
+		}
+
+		/** get number of examples after which averaging starts
+		 *
+		 * @return number of examples
+		 */
+		inline int64_t get_averaging_start() { return avg_start; }
+
+		/** set mini-batch size
+		 *
+		 * The margins of a mini-batch of examples are computed with a single
+		 * call to DotFeatures::dense_dot_range using the weights at the
+		 * start of the batch, the examples are then applied one by one.
+		 * Ignored in the multithreaded mode and for streaming features.
+		 *
+		 * @param size mini-batch size, 1 disables mini-batches
+		 */
+		inline void set_batch_size(int32_t size)
+		{
+			require(size > 0, "Mini-batch size must be positive!");
+			batch_size=size;
+		}
+
+		/** get mini-batch size
+		 *
+		 * @return mini-batch size
+		 */
+		inline int32_t get_batch_size() { return batch_size; }
+
+		/** train on a stream of labeled examples in a single pass
+		 *
+		 * Each example is read, applied and released, so memory does not
+		 * depend on the length of the stream. There is no calibration
+		 * pass, hence the bias scale is kept and the weight decay is
+		 * applied after every example. Best combined with averaged SGD.
+		 *
+		 * @param features labeled streaming features
+		 * @param num_examples expected length of the stream, which
+		 * determines lambda = 1 / (C1 * num_examples)
+		 * @return whether training was successful
+		 */
+		bool train_streaming(const std::shared_ptr<StreamingDotFeatures>& features,
+			int64_t num_examples);
+
 		/** set if bias shall be enabled
 		 *
 		 * @param enable_bias if bias shall be enabled
@@ -127,6 +227,71 @@ class SVMSGD : public LinearMachine
 		/** calibrate */
 		void calibrate(const std::shared_ptr<DotFeatures>& features);
 
+		/** fold the scale wscale into the weight vector and reset it to 1
+		 *
+		 * @param w weight vector v of the representation w = wscale * v
+		 */
+		void renormalize(SGVector<float64_t>& w);
+
+		/** one lock-free multithreaded epoch over all examples
+		 *
+		 * @param features training features
+		 * @param labels training labels
+		 * @param w weight vector v of the representation w = wscale * v
+		 * @param lambda regularization constant
+		 */
+		void train_epoch_hogwild(const std::shared_ptr<DotFeatures>& features,
+			const std::shared_ptr<BinaryLabels>& labels, SGVector<float64_t>& w,
+			float64_t lambda);
+
+		/** initialize t and reset the averaging
+		 *
+		 * @param lambda regularization constant
+		 * @return initial learning rate eta0
+		 */
+		float64_t init_schedule(float64_t lambda);
+
+		/** learning rate of the current step t
+		 *
+		 * @param lambda regularization constant
+		 * @param eta0 initial learning rate
+		 * @return learning rate
+		 */
+		float64_t learning_rate(float64_t lambda, float64_t eta0) const;
+
+		/** @return whether every example causes an update */
+		bool is_log_loss() const;
+
+		/** update the bias for an example with margin z
+		 *
+		 * @param z margin y * (w'x + b)
+		 * @param y label
+		 * @param eta learning rate
+		 * @param lambda regularization constant
+		 * @param log_loss result of is_log_loss(), fixed during training
+		 * @return coefficient of x in the update of v, 0 if there is none
+		 */
+		float64_t update(float64_t z, float64_t y, float64_t eta, float64_t lambda,
+			bool log_loss);
+
+		/** start averaging at the current iterate
+		 *
+		 * @param w weight vector v of the representation w = wscale * v
+		 */
+		void start_averaging(const SGVector<float64_t>& w);
+
+		/** add the current iterate to the average
+		 *
+		 * @param mu weight of the current iterate
+		 */
+		void average(float64_t mu);
+
+		/** fold the scale (and the average) into w and set it as solution
+		 *
+		 * @param w weight vector v of the representation w = wscale * v
+		 */
+		void finish(SGVector<float64_t>& w);
+
 		/** train classifier
 		 *
 		 * @param data training data (parameter can be avoided if distance or
@@ -149,6 +314,15 @@ class SVMSGD : public LinearMachine
 		int32_t epochs;
 		int32_t skip;
 		int32_t count;
+		int32_t num_threads;
+		int32_t batch_size;
+
+		bool averaged;
+		int64_t avg_start;
+		SGVector<float64_t> avg_u;
+		float64_t avg_wfrac;
+		float64_t avg_div;
+		float64_t avg_bias;
 
 		bool use_bias;
 		bool use_regularized_bias;
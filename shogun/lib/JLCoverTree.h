@@ -329,6 +329,17 @@ node<P> batch_create(v_array<P> points)
   return top;
 }
 
+/** Releases the children of a tree built by batch_create */
+template<class P>
+void free_children(node<P> &top_node)
+{
+  for (int i = 0; i < top_node.num_children; i++)
+    free_children(top_node.children[i]);
+  free(top_node.children);
+  top_node.children = NULL;
+  top_node.num_children = 0;
+}
+
 void add_height(int d, v_array<int> &heights)
 {
   if (heights.index <= d)
@@ -481,10 +492,34 @@ inline bool shell(float parent_query_dist, float child_parent_dist, float upper_
   //    && child_parent_dist - parent_query_dist <= upper_bound;
 }
 
-int internal_k =1;
-void update_k(float *k_upper_bound, float upper_bound)
+/**
+ * State of a nearest neighbor query. Kept per query instead of globally,
+ * so that several queries can run concurrently.
+ */
+struct nn_query_context {
+
+  /** Number of neighbors of a k-NN query */
+  int k;
+
+  /** Radius of an epsilon-NN query */
+  float epsilon;
+
+  /** 1+eps for a (1+eps)-approximate query, 1 for an exact one */
+  float approx;
+
+  /** Updates the upper bound(s) with a newly found distance */
+  void (*update)(const nn_query_context &ctx, float *upper_bound, float new_dist);
+
+  /** Sets the upper bound(s) to an initial value */
+  void (*setter)(const nn_query_context &ctx, float *upper_bound, float max);
+
+  /** Allocates the upper bound(s) */
+  float* (*alloc_upper)(const nn_query_context &ctx);
+};
+
+inline void update_k(const nn_query_context &ctx, float *k_upper_bound, float upper_bound)
 {
-  float *end = k_upper_bound + internal_k-1;
+  float *end = k_upper_bound + ctx.k-1;
   float *begin = k_upper_bound;
   for (;end != begin; begin++)
     {
@@ -498,44 +533,77 @@ void update_k(float *k_upper_bound, float upper_bound)
   if (end == begin)
     *begin = upper_bound;
 }
-float *alloc_k()
+inline float *alloc_k(const nn_query_context &ctx)
 {
-  return (float *)malloc(sizeof(float) * internal_k);
+  return (float *)malloc(sizeof(float) * ctx.k);
 }
-void set_k(float* begin, float max)
+inline void set_k(const nn_query_context &ctx, float* begin, float max)
 {
-  for(float *end = begin+internal_k;end != begin; begin++)
+  for(float *end = begin+ctx.k;end != begin; begin++)
     *begin = max;
 }
 
-float internal_epsilon =0.;
-void update_epsilon(float *upper_bound, float new_dist) {}
-float *alloc_epsilon()
+inline void update_epsilon(const nn_query_context &ctx, float *upper_bound, float new_dist) {}
+inline float *alloc_epsilon(const nn_query_context &ctx)
 {
   return (float *)malloc(sizeof(float));
 }
-void set_epsilon(float* begin, float max)
+inline void set_epsilon(const nn_query_context &ctx, float* begin, float max)
 {
-  *begin = internal_epsilon;
+  *begin = ctx.epsilon;
 }
 
-void update_unequal(float *upper_bound, float new_dist)
+inline void update_unequal(const nn_query_context &ctx, float *upper_bound, float new_dist)
 {
   if (new_dist != 0.)
     *upper_bound = new_dist;
 }
-float* (*alloc_unequal)() = alloc_epsilon;
-void set_unequal(float* begin, float max)
+inline float *alloc_unequal(const nn_query_context &ctx)
+{
+  return alloc_epsilon(ctx);
+}
+inline void set_unequal(const nn_query_context &ctx, float* begin, float max)
 {
   *begin = max;
 }
 
-void (*update)(float *foo, float bar) = update_k;
-void (*setter)(float *foo, float bar) = set_k;
-float* (*alloc_upper)() = alloc_k;
+/** @return context of a k nearest neighbor query, (1+approx_eps)-approximate
+ *  if approx_eps > 0 */
+inline nn_query_context k_query_context(int k, float approx_eps=0.)
+{
+  nn_query_context ctx = {k, 0., 1.+approx_eps, update_k, set_k, alloc_k};
+  return ctx;
+}
+
+/** @return context of an epsilon nearest neighbor query */
+inline nn_query_context epsilon_query_context(float epsilon)
+{
+  nn_query_context ctx = {1, epsilon, 1., update_epsilon, set_epsilon, alloc_epsilon};
+  return ctx;
+}
+
+/** @return context of a nearest unequal neighbor query */
+inline nn_query_context unequal_query_context()
+{
+  nn_query_context ctx = {1, 0., 1., update_unequal, set_unequal, alloc_unequal};
+  return ctx;
+}
+
+/**
+ * Whether a node at distance d with descendants up to max_dist away has to
+ * be kept given the bound. Exact queries keep it if d <= bound + max_dist.
+ * Approximate ones drop the descendants if they can only improve the bound
+ * by less than a factor 1+eps, but always keep a node whose own point is
+ * within the bound, since it may already be one of the neighbors.
+ */
+inline bool within(const nn_query_context &ctx, float d, float bound, float max_dist)
+{
+  return d <= bound || (d - max_dist) * ctx.approx <= bound;
+}
 
 template <class P>
-inline void copy_zero_set(node<P>* query_chi, float* new_upper_bound,
+inline void copy_zero_set(const nn_query_context &ctx,
+			    node<P>* query_chi, float* new_upper_bound,
 			    v_array<d_node<P> > &zero_set, v_array<d_node<P> > &new_zero_set)
 {
   new_zero_set.index = 0;
@@ -550,7 +618,7 @@ inline void copy_zero_set(node<P>* query_chi, float* new_upper_bound,
 	  if (d <= upper_dist)
 	    {
 	      if (d < *new_upper_bound)
-		update(new_upper_bound, d);
+		ctx.update(ctx, new_upper_bound, d);
 	      d_node<P> temp = {d, ele->n};
 	      push(new_zero_set,temp);
 	    }
@@ -559,7 +627,8 @@ inline void copy_zero_set(node<P>* query_chi, float* new_upper_bound,
 }
 
 template <class P>
-inline void copy_cover_sets(node<P>* query_chi, float* new_upper_bound,
+inline void copy_cover_sets(const nn_query_context &ctx,
+			      node<P>* query_chi, float* new_upper_bound,
 			      v_array<v_array<d_node<P> > > &cover_sets,
 			      v_array<v_array<d_node<P> > > &new_cover_sets,
 			      int current_scale, int max_scale)
@@ -575,10 +644,10 @@ inline void copy_cover_sets(node<P>* query_chi, float* new_upper_bound,
 	    {
 	      float d = distance(query_chi->p, ele->n->p, upper_dist);
 
-	      if (d <= upper_dist)
+	      if (within(ctx, d, upper_dist - ele->n->max_dist, ele->n->max_dist))
 		{
 		  if (d < *new_upper_bound)
-		    update(new_upper_bound,d);
+		    ctx.update(ctx, new_upper_bound, d);
 		  d_node<P> temp = {d, ele->n};
 		  push(new_cover_sets[current_scale],temp);
 		}
@@ -640,7 +709,8 @@ void print_cover_sets(v_array<v_array<d_node<P> > > &cover_sets,
 
 template <class P>
 inline
-void descend(const node<P>* query, float* upper_bound,
+void descend(const nn_query_context &ctx,
+		      const node<P>* query, float* upper_bound,
 		      int current_scale,
 		      int &max_scale, v_array<v_array<d_node<P> > > &cover_sets,
 		      v_array<d_node<P> > &zero_set)
@@ -650,10 +720,10 @@ void descend(const node<P>* query, float* upper_bound,
     {
       const node<P> *par = parent->n;
       float upper_dist = *upper_bound + query->max_dist + query->max_dist;
-      if (parent->dist <= upper_dist + par->max_dist)
+      if (within(ctx, parent->dist, upper_dist, par->max_dist))
 	{
 	  node<P> *chi = par->children;
-	  if (parent->dist <= upper_dist + chi->max_dist)
+	  if (within(ctx, parent->dist, upper_dist, chi->max_dist))
             {
 	    if (chi->num_children > 0)
 	      {
@@ -675,10 +745,10 @@ void descend(const node<P>* query, float* upper_bound,
 	      if (shell(parent->dist, chi->parent_dist, upper_chi))
 		{
 		  float d = distance(query->p, chi->p, upper_chi);
-		  if (d <= upper_chi)
+		  if (within(ctx, d, upper_chi - chi->max_dist, chi->max_dist))
 		    {
 		      if (d < *upper_bound)
-			update(upper_bound, d);
+			ctx.update(ctx, upper_bound, d);
 		      if (chi->num_children > 0)
 			{
 			  if (max_scale < chi->scale)
@@ -700,7 +770,8 @@ void descend(const node<P>* query, float* upper_bound,
 }
 
 template <class P>
-void brute_nearest(const node<P>* query,v_array<d_node<P> > zero_set,
+void brute_nearest(const nn_query_context &ctx,
+		   const node<P>* query,v_array<d_node<P> > zero_set,
 		   float* upper_bound,
 		   v_array<v_array<P> > &results,
 		   v_array<v_array<d_node<P> > > &spare_zero_sets)
@@ -709,15 +780,15 @@ void brute_nearest(const node<P>* query,v_array<d_node<P> > zero_set,
     {
       v_array<d_node<P> > new_zero_set = pop(spare_zero_sets);
       node<P> * query_chi = query->children;
-      brute_nearest(query_chi, zero_set, upper_bound, results, spare_zero_sets);
-      float* new_upper_bound = alloc_upper();
+      brute_nearest(ctx, query_chi, zero_set, upper_bound, results, spare_zero_sets);
+      float* new_upper_bound = ctx.alloc_upper(ctx);
 
       node<P> *child_end = query->children + query->num_children;
       for (query_chi++;query_chi != child_end; query_chi++)
 	{
-	  setter(new_upper_bound,*upper_bound + query_chi->parent_dist);
-	  copy_zero_set(query_chi, new_upper_bound, zero_set, new_zero_set);
-	  brute_nearest(query_chi, new_zero_set, new_upper_bound, results, spare_zero_sets);
+	  ctx.setter(ctx, new_upper_bound,*upper_bound + query_chi->parent_dist);
+	  copy_zero_set(ctx, query_chi, new_upper_bound, zero_set, new_zero_set);
+	  brute_nearest(ctx, query_chi, new_zero_set, new_upper_bound, results, spare_zero_sets);
 	}
       free (new_upper_bound);
       new_zero_set.index = 0;
@@ -736,7 +807,8 @@ void brute_nearest(const node<P>* query,v_array<d_node<P> > zero_set,
 }
 
 template <class P>
-void internal_batch_nearest_neighbor(const node<P> *query,
+void internal_batch_nearest_neighbor(const nn_query_context &ctx,
+				     const node<P> *query,
 				     v_array<v_array<d_node<P> > > &cover_sets,
 				     v_array<d_node<P> > &zero_set,
 				     int current_scale,
@@ -747,7 +819,7 @@ void internal_batch_nearest_neighbor(const node<P> *query,
 				     v_array<v_array<d_node<P> > > &spare_zero_sets)
 {
   if (current_scale > max_scale) // All remaining points are in the zero set.
-    brute_nearest(query, zero_set, upper_bound, results, spare_zero_sets);
+    brute_nearest(ctx, query, zero_set, upper_bound, results, spare_zero_sets);
   else
     if (query->scale <= current_scale && query->scale != 100)
       // Our query has too much scale.  Reduce.
@@ -755,16 +827,16 @@ void internal_batch_nearest_neighbor(const node<P> *query,
 	node<P> *query_chi = query->children;
 	v_array<d_node<P> > new_zero_set = pop(spare_zero_sets);
 	v_array<v_array<d_node<P> > > new_cover_sets = get_cover_sets(spare_cover_sets);
-	float* new_upper_bound = alloc_upper();
+	float* new_upper_bound = ctx.alloc_upper(ctx);
 
 	node<P> *child_end = query->children + query->num_children;
 	for (query_chi++; query_chi != child_end; query_chi++)
 	  {
-	    setter(new_upper_bound,*upper_bound + query_chi->parent_dist);
-	    copy_zero_set(query_chi, new_upper_bound, zero_set, new_zero_set);
-	    copy_cover_sets(query_chi, new_upper_bound, cover_sets, new_cover_sets,
+	    ctx.setter(ctx, new_upper_bound,*upper_bound + query_chi->parent_dist);
+	    copy_zero_set(ctx, query_chi, new_upper_bound, zero_set, new_zero_set);
+	    copy_cover_sets(ctx, query_chi, new_upper_bound, cover_sets, new_cover_sets,
 			      current_scale, max_scale);
-	    internal_batch_nearest_neighbor(query_chi, new_cover_sets, new_zero_set,
+	    internal_batch_nearest_neighbor(ctx, query_chi, new_cover_sets, new_zero_set,
 					    current_scale, max_scale, new_upper_bound,
 					    results, spare_cover_sets, spare_zero_sets);
 	  }
@@ -772,23 +844,24 @@ void internal_batch_nearest_neighbor(const node<P> *query,
 	new_zero_set.index = 0;
 	push(spare_zero_sets, new_zero_set);
 	push(spare_cover_sets, new_cover_sets);
-	internal_batch_nearest_neighbor(query->children, cover_sets, zero_set,
+	internal_batch_nearest_neighbor(ctx, query->children, cover_sets, zero_set,
 					current_scale, max_scale, upper_bound, results,
 					spare_cover_sets, spare_zero_sets);
       }
     else // reduce cover set scale
       {
 	halfsort(cover_sets[current_scale]);
-	descend(query, upper_bound, current_scale, max_scale,cover_sets, zero_set);
+	descend(ctx, query, upper_bound, current_scale, max_scale,cover_sets, zero_set);
 	cover_sets[current_scale++].index = 0;
-	internal_batch_nearest_neighbor(query, cover_sets, zero_set,
+	internal_batch_nearest_neighbor(ctx, query, cover_sets, zero_set,
 					current_scale, max_scale, upper_bound, results,
 					spare_cover_sets, spare_zero_sets);
       }
 }
 
 template <class P>
-void batch_nearest_neighbor(const node<P> &top_node, const node<P> &query,
+void batch_nearest_neighbor(const nn_query_context &ctx,
+			    const node<P> &top_node, const node<P> &query,
 			    v_array<v_array<P> > &results)
 {
   v_array<v_array<v_array<d_node<P> > > > spare_cover_sets;
@@ -797,16 +870,16 @@ void batch_nearest_neighbor(const node<P> &top_node, const node<P> &query,
   v_array<v_array<d_node<P> > > cover_sets = get_cover_sets(spare_cover_sets);
   v_array<d_node<P> > zero_set = pop(spare_zero_sets);
 
-  float* upper_bound = alloc_upper();
-  setter(upper_bound,FLT_MAX);
+  float* upper_bound = ctx.alloc_upper(ctx);
+  ctx.setter(ctx, upper_bound,FLT_MAX);
 
   float top_dist = distance(query.p, top_node.p, FLT_MAX);
-  update(upper_bound, top_dist);
+  ctx.update(ctx, upper_bound, top_dist);
 
   d_node<P> temp = {top_dist, &top_node};
   push(cover_sets[0], temp);
 
-  internal_batch_nearest_neighbor(&query,cover_sets,zero_set,0,0,upper_bound,results,
+  internal_batch_nearest_neighbor(ctx, &query,cover_sets,zero_set,0,0,upper_bound,results,
 				  spare_cover_sets,spare_zero_sets);
 
   free(upper_bound);
@@ -828,39 +901,116 @@ void batch_nearest_neighbor(const node<P> &top_node, const node<P> &query,
   free(spare_zero_sets.elements);
 }
 
+/**
+ * Splits a query tree into disjoint subtrees covering all of its points.
+ * A node is replaced by its children, the first of which holds the point
+ * of the node itself, level by level until there are at least min_parts
+ * subtrees or only leaves are left.
+ */
+template <class P>
+v_array<const node<P>*> split_query(const node<P> &query, int min_parts)
+{
+  v_array<const node<P>*> parts;
+  push(parts, &query);
+
+  bool expanded = true;
+  while (parts.index < min_parts && expanded)
+    {
+      v_array<const node<P>*> next;
+      expanded = false;
+      for (int i = 0; i < parts.index; i++)
+	{
+	  const node<P> *n = parts[i];
+	  if (n->num_children > 0)
+	    {
+	      for (int j = 0; j < n->num_children; j++)
+		push(next, (const node<P>*)&n->children[j]);
+	      expanded = true;
+	    }
+	  else
+	    push(next, n);
+	}
+      free(parts.elements);
+      parts = next;
+    }
+
+  return parts;
+}
+
+/**
+ * Runs a query for all points of the query tree. With several threads the
+ * query tree is split into subtrees which are searched concurrently, each
+ * with its own cover sets. The distance of the points must be safe to
+ * evaluate from several threads then.
+ */
+template <class P>
+void parallel_nearest_neighbor(const nn_query_context &ctx,
+			       const node<P> &top_node, const node<P> &query,
+			       v_array<v_array<P> > &results, int num_threads)
+{
+  if (num_threads <= 1)
+    {
+      batch_nearest_neighbor(ctx, top_node, query, results);
+      return;
+    }
+
+  v_array<const node<P>*> parts = split_query(query, 8*num_threads);
+  v_array<v_array<v_array<P> > > part_results;
+  alloc(part_results, parts.index);
+  for (int i = 0; i < parts.index; i++)
+    push(part_results, v_array<v_array<P> >());
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+  for (int i = 0; i < parts.index; i++)
+    batch_nearest_neighbor(ctx, top_node, *parts[i], part_results[i]);
+
+  for (int i = 0; i < parts.index; i++)
+    {
+      for (int j = 0; j < part_results[i].index; j++)
+	push(results, part_results[i][j]);
+      free(part_results[i].elements);
+    }
+  free(part_results.elements);
+  free(parts.elements);
+}
+
 template <class P>
 void k_nearest_neighbor(const node<P> &top_node, const node<P> &query,
-			v_array<v_array<P> > &results, int k)
+			v_array<v_array<P> > &results, int k, int num_threads=1)
 {
-  internal_k = k;
-  update = update_k;
-  setter = set_k;
-  alloc_upper = alloc_k;
+  parallel_nearest_neighbor(k_query_context(k), top_node, query, results,
+			    num_threads);
+}
 
-  batch_nearest_neighbor(top_node, query,results);
+/**
+ * (1+eps)-approximate k nearest neighbors. Subtrees whose points cannot
+ * be closer than the current k-th neighbor divided by 1+eps are not
+ * searched, eps = 0 is the exact query.
+ */
+template <class P>
+void approx_k_nearest_neighbor(const node<P> &top_node, const node<P> &query,
+			       v_array<v_array<P> > &results, int k, float eps,
+			       int num_threads=1)
+{
+  parallel_nearest_neighbor(k_query_context(k, eps), top_node, query, results,
+			    num_threads);
 }
 
 template <class P>
 void epsilon_nearest_neighbor(const node<P> &top_node, const node<P> &query,
-			      v_array<v_array<P> > &results, float epsilon)
+			      v_array<v_array<P> > &results, float epsilon,
+			      int num_threads=1)
 {
-  internal_epsilon = epsilon;
-  update = update_epsilon;
-  setter = set_epsilon;
-  alloc_upper = alloc_epsilon;
-
-  batch_nearest_neighbor(top_node, query,results);
+  parallel_nearest_neighbor(epsilon_query_context(epsilon), top_node, query,
+			    results, num_threads);
 }
 
 template <class P>
 void unequal_nearest_neighbor(const node<P> &top_node, const node<P> &query,
-			      v_array<v_array<P> > &results)
+			      v_array<v_array<P> > &results, int num_threads=1)
 {
-  update = update_unequal;
-  setter = set_unequal;
-  alloc_upper = alloc_unequal;
-
-  batch_nearest_neighbor(top_node, query, results);
+  parallel_nearest_neighbor(unequal_query_context(), top_node, query, results,
+			    num_threads);
 }
 
 #endif
@@ -14,8 +14,12 @@
 
 #include <shogun/lib/config.h>
 #include <shogun/distance/Distance.h>
+#include <shogun/distance/EuclideanDistance.h>
+#include <shogun/features/DenseFeatures.h>
 #include <shogun/features/Features.h>
 
+#include <cmath>
+
 namespace shogun
 {
 
@@ -110,10 +114,57 @@ enum EFeaturesContainer
 	FC_RHS = 1,
 };
 
+/** @brief Euclidean distance of two dense vectors that stops once the
+ * upper bound is exceeded. The squared distance is accumulated in blocks
+ * and compared to the bound after each block. The sum inside a block is
+ * an OpenMP simd reduction, so it is vectorized without -ffast-math.
+ */
+template<class T, bool squared>
+struct UpperBoundedEuclideanDistance
+{
+	/** elements accumulated between two checks of the bound */
+	static const int32_t block_size = 16;
+
+	/** @return distance of x and y or a value larger than upper_bound */
+	inline float64_t operator()(const T* x, const T* y, int32_t dim,
+			float64_t upper_bound) const
+	{
+		const float64_t bound = squared ? upper_bound : upper_bound*upper_bound;
+		float64_t sum = 0;
+		int32_t i = 0;
+
+		for (; i + block_size <= dim; i += block_size)
+		{
+			float64_t block = 0;
+			#pragma omp simd reduction(+:block)
+			for (int32_t j = 0; j < block_size; ++j)
+			{
+				const float64_t diff = float64_t(x[i+j]) - float64_t(y[i+j]);
+				block += diff*diff;
+			}
+			sum += block;
+
+			if (sum > bound)
+				return squared ? sum : std::sqrt(sum);
+		}
+
+		for (; i < dim; ++i)
+		{
+			const float64_t diff = float64_t(x[i]) - float64_t(y[i]);
+			sum += diff*diff;
+		}
+
+		return squared ? sum : std::sqrt(sum);
+	}
+};
+
 /** @brief Class Point to use with John Langford's CoverTree. This
  * class must have some assoficated functions defined (distance,
  * parse_points and print, see below) so it can be used with the
  * CoverTree implementation.
+ *
+ * The point is copied around a lot by the tree, hence it only holds plain
+ * pointers. The Distance object has to outlive the point.
  */
 class JLCoverTreePoint
 {
@@ -121,8 +172,8 @@ class JLCoverTreePoint
 	public:
 
 		/** Distance object where to find the coordinate information of
-		 * this point */
-		std::shared_ptr<Distance> m_distance;
+		 * this point, not owned */
+		Distance* m_distance;
 
 		/** Index of this point in m_distance */
 		int32_t m_index;
@@ -130,13 +181,36 @@ class JLCoverTreePoint
 		/** If the point is stored in rhs or lhs in m_distance */
 		EFeaturesContainer m_features_container;
 
+		/** Coordinates of the point if m_distance is the Euclidean distance
+		 * of dense real features, NULL otherwise. They are owned by the
+		 * features of m_distance. */
+		const float64_t* m_vector;
+
+		/** Dimension of m_vector */
+		int32_t m_dim;
+
+		/** If m_distance computes the squared Euclidean distance */
+		bool m_squared;
+
 }; /* class JLCoverTreePoint */
 
 /** Functions declared out of the class definition to respect JLCoverTree
  *  structure */
 
-float distance(JLCoverTreePoint p1, JLCoverTreePoint p2, float64_t upper_bound)
+inline float distance(const JLCoverTreePoint& p1, const JLCoverTreePoint& p2, float64_t upper_bound)
 {
+	// Dense Euclidean fast path, no virtual call. parse_points makes sure
+	// the query points have the dimension of the training points.
+	if ( p1.m_vector && p2.m_vector )
+	{
+		if ( p1.m_squared )
+			return UpperBoundedEuclideanDistance<float64_t, true>()(
+					p1.m_vector, p2.m_vector, p1.m_dim, upper_bound);
+		else
+			return UpperBoundedEuclideanDistance<float64_t, false>()(
+					p1.m_vector, p2.m_vector, p1.m_dim, upper_bound);
+	}
+
 	/** Call m_distance->distance() with the proper index order depending on
 	 *  the feature containers in m_distance for each of the points*/
 
@@ -179,7 +253,8 @@ float distance(JLCoverTreePoint p1, JLCoverTreePoint p2, float64_t upper_bound)
 	return -1;
 }
 
-/** Fills up a v_array of JLCoverTreePoint objects */
+/** Fills up a v_array of JLCoverTreePoint objects. The features must not
+ *  be modified while the points are in use. */
 v_array< JLCoverTreePoint > parse_points(std::shared_ptr<Distance> distance, EFeaturesContainer fc)
 {
 	std::shared_ptr<Features> features;
@@ -188,14 +263,63 @@ v_array< JLCoverTreePoint > parse_points(std::shared_ptr<Distance> distance, EFe
 	else
 		features = distance->get_rhs();
 
+	// The Euclidean distance of dense real features is evaluated directly
+	// on the feature matrix
+	std::shared_ptr<DenseFeatures<float64_t>> dense;
+	bool squared = false;
+	if ( distance->get_distance_type() == D_EUCLIDEAN &&
+			features->get_feature_class() == C_DENSE &&
+			features->get_feature_type() == F_DREAL )
+	{
+		dense = features->as<DenseFeatures<float64_t>>();
+		squared = distance->as<EuclideanDistance>()->get_disable_sqrt();
+
+		// distance() compares the coordinates of query and training
+		// points directly, so their dimensions are checked here once
+		auto lhs = distance->get_lhs();
+		if ( fc == FC_RHS && lhs && lhs->get_feature_class() == C_DENSE &&
+				lhs->get_feature_type() == F_DREAL )
+		{
+			int32_t num_lhs = lhs->as<DenseFeatures<float64_t>>()->get_num_features();
+			require(dense->get_num_features() == num_lhs,
+					"Test vectors of dimension {} cannot be compared to "
+					"training vectors of dimension {}",
+					dense->get_num_features(), num_lhs);
+		}
+	}
+
 	v_array< JLCoverTreePoint > parsed;
 	for ( int32_t i = 0 ; i < features->get_num_vectors() ; ++i )
 	{
 		JLCoverTreePoint new_point;
 
-		new_point.m_distance = distance;
+		new_point.m_distance = distance.get();
 		new_point.m_index = i;
 		new_point.m_features_container = fc;
+		new_point.m_vector = NULL;
+		new_point.m_dim = 0;
+		new_point.m_squared = squared;
+
+		if ( dense )
+		{
+			bool dofree = false;
+			int32_t len = 0;
+			float64_t* vec = dense->get_feature_vector(i, len, dofree);
+
+			// Vectors computed on the fly are not kept, this and all
+			// following points use the Distance object. Pairs with
+			// a point without coordinates always do.
+			if ( dofree )
+			{
+				dense->free_feature_vector(vec, i, dofree);
+				dense.reset();
+			}
+			else
+			{
+				new_point.m_vector = vec;
+				new_point.m_dim = len;
+			}
+		}
 
 		push(parsed, new_point);
 	}
@@ -101,6 +101,12 @@ QPproblem::QPproblem()
   q                    = -1;
   y                    = NULL;
   tau_proximal         = 0.0;
+  nthreads             = 1;
+  nparts               = 1;
+  float32_cache        = (sizeof(KERNELCACHE_ELEM) == sizeof(float32_t));
+  cache_hits           = 0;
+  cache_misses         = 0;
+  cache_evictions      = 0;
   dim = 1;
 }
 
@@ -207,6 +213,17 @@ void SplitParts(
   else
      *off = *dim * part + r;
 }
+
+/******************************************************************************/
+/*** Compute the sizes and offsets of all the parts of a data splitting     ***/
+/******************************************************************************/
+void SplitNum(int32_t n, int32_t parts, int32_t *nloc, int32_t *noff)
+{
+  int32_t i;
+
+  for (i = 0; i < parts; i++)
+      SplitParts(n, i, parts, &nloc[i], &noff[i]);
+}
 }
 /******************************************************************************/
 /*** Kernel class constructor                                               ***/
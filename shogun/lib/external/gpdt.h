@@ -156,6 +156,19 @@ public:
     return kernel->kernel(i, j);
   }
 
+  /** get an item from the kernel without counting the evaluation,
+   * safe to call from several threads (add the evaluations to
+   * KernelEvaluations afterwards)
+   *
+   * @param i index i
+   * @param j index j
+   * @return item from kernel at index i, j
+   */
+  float64_t Eval(int32_t i, int32_t j)
+  {
+    return kernel->kernel(i, j);
+  }
+
   /** add something
    *
    * @param v v
@@ -193,7 +206,7 @@ private:
 
 void SplitParts (
 	int32_t n, int32_t part, int32_t parts, int32_t *dim, int32_t *off);
-void SplitNum   (int32_t n, int32_t *nloc, int32_t *noff);
+void SplitNum   (int32_t n, int32_t parts, int32_t *nloc, int32_t *noff);
 }
 #endif // DOXYGEN_SHOULD_SKIP_THIS
 
@@ -108,22 +108,30 @@ void quick_s2 (float64_t a[], int32_t k, int32_t ia[]);
 
 /******************************************************************************/
 /*** Class for caching strategy implementation                              ***/
+/*** T is the type of the cached kernel values (float32_t or float64_t)     ***/
 /******************************************************************************/
+template <class T>
 class sCache
 {
 
 public:
-  sCache  (sKernel* sk, int32_t Mbyte, int32_t ell);
+  sCache  (sKernel* sk, int32_t Mbyte, int32_t ell, int32_t parts = 1);
   ~sCache ();
 
-  cachetype *FillRow (int32_t row, int32_t IsC = 0);
-  cachetype *GetRow  (int32_t row);
+  T *FillRow  (int32_t row, int32_t IsC = 0);
+  T *GetRow   (int32_t row);
+  int32_t FillRows (int32_t *rows, int32_t n);
 
   int32_t DivideMP (int32_t *out, int32_t *in, int32_t n);
 
   /*** Itarations counter ***/
   void Iteration() { nit++; }
 
+  /*** Cache statistics ***/
+  int64_t Hits()      { return hits; }
+  int64_t Misses()    { return misses; }
+  int64_t Evictions() { return evictions; }
+
   /*** Cache size control ***/
   int32_t CheckCycle()
   {
@@ -143,61 +151,71 @@ private:
   {
     int32_t row;      // unused row
     int32_t last_access_it;
+    int32_t prefilled; // filled by FillRows, counted as a miss already
     cache_entry *prev, *next;
-    cachetype   *data;
+    T           *data;
   };
 
   sKernel* KER;
   int32_t maxmw, ell;
   int32_t nit;
+  int32_t nparts;   // number of threads computing rows
+  int64_t hits, misses, evictions;
 
   cache_entry *mw;
   cache_entry *first_free;
-  cache_entry **pindmw;    // 0 if unused row
-  cachetype   *onerow;
+  cache_entry **pindmw;    // 0 if unused row, indexed by the row number
+  T           *onerow;
 
-  cachetype   *FindFree(int32_t row, int32_t IsC);
+  T           *FindFree(int32_t row, int32_t IsC);
 };
 
 
 /******************************************************************************/
 /*** Cache class constructor                                                ***/
 /******************************************************************************/
-sCache::sCache(sKernel* sk, int32_t Mbyte, int32_t _ell) : KER(sk), ell(_ell)
+template <class T>
+sCache<T>::sCache(sKernel* sk, int32_t Mbyte, int32_t _ell, int32_t parts)
+  : KER(sk), ell(_ell), nparts(parts)
 {
   int32_t i;
 
   // size in dwords of one cache row
   maxmw = (sizeof(cache_entry) + sizeof(cache_entry *)
-           + ell*sizeof(cachetype)) / 4;
+           + ell*sizeof(T)) / 4;
   // number of cache rows
   maxmw = Mbyte*1024*(1024/4) / maxmw;
 
   /* arrays allocation */
   mw     = SG_MALLOC(cache_entry, maxmw);
   pindmw = SG_MALLOC(cache_entry*,  ell);
-  onerow = SG_MALLOC(cachetype,     ell);
+  onerow = SG_MALLOC(T,             ell);
 
   /* arrays initialization */
   for (i = 0; i < maxmw; i++)
   {
       mw[i].prev           = (i == 0 ? &mw[maxmw-1] : &mw[i-1]);
       mw[i].next           = (i == maxmw-1 ? &mw[0] : &mw[i+1]);
-      mw[i].data           = SG_MALLOC(cachetype, ell);
+      mw[i].data           = SG_MALLOC(T, ell);
       mw[i].row            = -1;    // unused row
       mw[i].last_access_it = -1;
+      mw[i].prefilled      = 0;
   }
   for (i = 0; i < ell; i++)
       pindmw[i] = 0;
 
   first_free = &mw[0];
   nit        = 0;
+  hits       = 0;
+  misses     = 0;
+  evictions  = 0;
 }
 
 /******************************************************************************/
 /*** Cache class destructor                                                 ***/
 /******************************************************************************/
-sCache::~sCache()
+template <class T>
+sCache<T>::~sCache()
 {
   int32_t i;
 
@@ -213,13 +231,22 @@ sCache::~sCache()
 /******************************************************************************/
 /*** Retrieve a cached row                                                  ***/
 /******************************************************************************/
-cachetype *sCache::GetRow(int32_t row)
+template <class T>
+T *sCache<T>::GetRow(int32_t row)
 {
   cache_entry *c;
 
   c = pindmw[row];
   if (c == NULL)
+  {
+      misses++;
       return NULL;
+  }
+  // the first access to a row computed by FillRows is its miss
+  if (c->prefilled)
+      c->prefilled = 0;
+  else
+      hits++;
 
   c->last_access_it = nit;
   if (c == first_free)
@@ -245,19 +272,24 @@ cachetype *sCache::GetRow(int32_t row)
  *** IMPORTANT: call this method only if you are sure that "row"            ***
  ***            is not already in the cache ( i.e. after calling GetRow() ) ***
  ******************************************************************************/
-cachetype *sCache::FindFree(int32_t row, int32_t IsC)
+template <class T>
+T *sCache<T>::FindFree(int32_t row, int32_t IsC)
 {
-  cachetype *pt;
+  T *pt;
 
   if (first_free->row != -1) // cache row already contains data
   {
       if (first_free->last_access_it == nit || IsC)
           return 0;
       else
+      {
           pindmw[first_free->row] = 0;
+          evictions++;
+      }
   }
   first_free->row            = row;
   first_free->last_access_it = nit;
+  first_free->prefilled      = 0;
   pindmw[row]                = first_free;
 
   pt         = first_free->data;
@@ -270,10 +302,11 @@ cachetype *sCache::FindFree(int32_t row, int32_t IsC)
 /******************************************************************************/
 /*** Enter data in a cache row                                              ***/
 /******************************************************************************/
-cachetype *sCache::FillRow(int32_t row, int32_t IsC)
+template <class T>
+T *sCache<T>::FillRow(int32_t row, int32_t IsC)
 {
   int32_t j;
-  cachetype *pt;
+  T *pt;
 
   pt = GetRow(row);
   if (pt != NULL)
@@ -284,16 +317,67 @@ cachetype *sCache::FillRow(int32_t row, int32_t IsC)
       pt = onerow;
 
   // Compute all the row elements
+#pragma omp parallel for num_threads(nparts) if (nparts > 1)
   for (j = 0; j < ell; j++)
-      pt[j] = (cachetype)KER->Get(row, j);
+      pt[j] = (T)KER->Eval(row, j);
+  KER->KernelEvaluations += ell;
   return pt;
 }
 
+/******************************************************************************/
+/*** Enter data in the cache for a whole set of rows                        ***/
+/******************************************************************************/
+template <class T>
+int32_t sCache<T>::FillRows(int32_t *rows, int32_t n)
+{
+   /********************************************************************
+    * The missing rows get their cache entries first, then all of      *
+    * them are computed at once, split among the threads. Rows which   *
+    * do not fit in the cache are left to FillRow.                     *
+    * Returns: the number of rows computed                             *
+    ********************************************************************/
+
+  int32_t i, nfill;
+  int32_t *fill;
+  T       **data;
+
+  fill = SG_MALLOC(int32_t, n);
+  data = SG_MALLOC(T*, n);
+
+  nfill = 0;
+  for (i = 0; i < n; i++)
+  {
+      if (pindmw[rows[i]] != NULL)
+          continue;
+
+      T *pt = FindFree(rows[i], 0);
+      if (pt == 0)
+          break;
+
+      misses++;
+      pindmw[rows[i]]->prefilled = 1;
+      fill[nfill] = rows[i];
+      data[nfill] = pt;
+      nfill++;
+  }
+
+#pragma omp parallel for schedule(dynamic) num_threads(nparts) if (nparts > 1)
+  for (int32_t r = 0; r < nfill; r++)
+      for (int32_t j = 0; j < ell; j++)
+          data[r][j] = (T)KER->Eval(fill[r], j);
+  KER->KernelEvaluations += (float64_t)nfill * ell;
+
+  SG_FREE(data);
+  SG_FREE(fill);
+  return nfill;
+}
+
 
 /******************************************************************************/
 /*** Expand a sparse row in a full cache row                                ***/
 /******************************************************************************/
-int32_t sCache::DivideMP(int32_t *out, int32_t *in, int32_t n)
+template <class T>
+int32_t sCache<T>::DivideMP(int32_t *out, int32_t *in, int32_t n)
 {
    /********************************************************************
     * Input meaning:                                                   *
@@ -326,6 +410,19 @@ int32_t sCache::DivideMP(int32_t *out, int32_t *in, int32_t n)
   return n;
 }
 
+/******************************************************************************/
+/*** st += a * row, each thread updating its own part of st                 ***/
+/******************************************************************************/
+template <class T>
+static void UpdateGradient(float64_t *st, T *row, float64_t a,
+                           int32_t parts, int32_t *recvl, int32_t *displ)
+{
+#pragma omp parallel for num_threads(parts) if (parts > 1)
+  for (int32_t p = 0; p < parts; p++)
+      for (int32_t i = displ[p]; i < displ[p] + recvl[p]; i++)
+          st[i] += a * row[i];
+}
+
 /******************************************************************************/
 /*** Check solution optimality                                              ***/
 /******************************************************************************/
@@ -773,13 +870,15 @@ int32_t QPproblem::Preprocess1(sKernel* kernel, int32_t *aux, int32_t *sv)
       if (sl < 500)
       {
           for (j = 0; j < ll; j++)
-          {
               sp_y[j] = y[aux[j+off]];
-              for (k = j; k < ll; k++)
-                  sp_D[k*sl + j] = sp_D[j*sl + k]
-                                 = y[aux[j+off]] * y[aux[k+off]]
-                                   * (float32_t)kernel->Get(aux[j+off], aux[k+off]);
-          }
+
+#pragma omp parallel for schedule(dynamic) num_threads(nparts) if (nparts > 1)
+          for (int32_t r = 0; r < ll; r++)
+              for (int32_t c = r; c < ll; c++)
+                  sp_D[c*sl + r] = sp_D[r*sl + c]
+                                 = y[aux[r+off]] * y[aux[c+off]]
+                                   * (float32_t)kernel->Eval(aux[r+off], aux[c+off]);
+          kernel->KernelEvaluations += (float64_t)ll * (ll+1) / 2;
 
           memset(sp_alpha, 0, sl*sizeof(float64_t));
 
@@ -871,12 +970,49 @@ int32_t QPproblem::Preprocess1(sKernel* kernel, int32_t *aux, int32_t *sv)
   return(nsv);
 }
 
+/******************************************************************************/
+/*** Split the components among the threads                                 ***/
+/******************************************************************************/
+void QPproblem::PrepMP(int32_t parts)
+{
+  if (parts < 1)
+      parts = 1;
+  if (parts > 32)
+      parts = 32;
+  if (parts > ell)
+      parts = ell;
+
+  nparts = parts;
+  SplitNum(ell, nparts, recvl, displ);
+}
+
 /******************************************************************************/
 /*** Compute the QP problem solution                                        ***/
 /******************************************************************************/
 float64_t QPproblem::gpdtsolve(float64_t *solution)
 {
-  int32_t i, j, k, z, iin, jin, nit, tot_vpm_iter, lsCount;
+  if (float32_cache)
+      return solve<float32_t>(solution, 1);
+  return solve<float64_t>(solution, 1);
+}
+
+/******************************************************************************/
+/*** Compute the QP problem solution using nthreads threads                 ***/
+/******************************************************************************/
+float64_t QPproblem::pgpdtsolve(float64_t *solution)
+{
+  if (float32_cache)
+      return solve<float32_t>(solution, nthreads);
+  return solve<float64_t>(solution, nthreads);
+}
+
+/******************************************************************************/
+/*** Decomposition technique shared by gpdtsolve and pgpdtsolve             ***/
+/******************************************************************************/
+template <class T>
+float64_t QPproblem::solve(float64_t *solution, int32_t parts)
+{
+  int32_t i, j, k, z, jin, nit, tot_vpm_iter, lsCount;
   int32_t tot_vpm_secant, projCount, proximal_count;
   int32_t vpmWarningThreshold;
   int32_t  nzin, nzout;
@@ -889,11 +1025,14 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
   float64_t    *vau;
   float64_t    *weight;
   float64_t    tot_prep_time, tot_vpm_time, tot_st_time, total_time;
-  sCache    *Cache;
-  cachetype *ptmw;
+  float64_t    kevals;
+  sCache<T> *Cache;
+  T         *ptmw;
+  T         **rowin;           /* cached rows of the working set            */
   clock_t   t, ti;
 
-  Cache = new sCache(KER, maxmw, ell);
+  PrepMP(parts);
+  Cache = new sCache<T>(KER, maxmw, ell, nparts);
     if (chunk_size > ell) chunk_size = ell;
 
   if (chunk_size <= 20)
@@ -998,6 +1137,7 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
   sp_alpha = SG_MALLOC(float64_t, chunk_size);
   sp_h     = SG_MALLOC(float64_t, chunk_size);
   sp_hloc  = SG_MALLOC(float64_t, chunk_size);
+  rowin    = SG_MALLOC(T*, chunk_size);
 
   for (i = 0; i < chunk_size; i++)
       cec[index_in[i]] = cec[index_in[i]]+1;
@@ -1061,33 +1201,50 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
       for (i = 0; i < chunk_size; i++)
           sp_y[i] = y_in(i);
 
-      /* Construct the objective function Hessian */
+      /* Construct the objective function Hessian: the rows are independent,
+       * entries kept from the previous working set are read from the upper
+       * triangle which is not written here */
       for (i = 0; i < chunk_size; i++)
+          rowin[i] = Cache->GetRow(index_in[i]);
+
+      kevals = 0.0;
+#pragma omp parallel for schedule(dynamic) num_threads(nparts) if (nparts > 1) reduction(+:kevals)
+      for (int32_t r = 0; r < chunk_size; r++)
       {
-          iin  = index_in[i];
-          ptmw = Cache->GetRow(iin);
-          if (ptmw != 0)
+          int32_t    rin  = index_in[r];
+          T         *prow = rowin[r];
+          int32_t    c;
+
+          if (prow != 0)
           {
-              for (j = 0; j <= i; j++)
-                  sp_D[i*chunk_size + j] = sp_y[i]*sp_y[j] * ptmw[index_in[j]];
+              for (c = 0; c <= r; c++)
+                  sp_D[r*chunk_size + c] = sp_y[r]*sp_y[c] * prow[index_in[c]];
+          }
+          else if (incom[r] == -1)
+          {
+              for (c = 0; c <= r; c++)
+                  sp_D[r*chunk_size + c] = sp_y[r]*sp_y[c]
+                                           * (float32_t)KER->Eval(rin, index_in[c]);
+              kevals += r + 1;
           }
-          else if (incom[i] == -1)
-              for (j = 0; j <= i; j++)
-                  sp_D[i*chunk_size + j] = sp_y[i]*sp_y[j]
-                                           * (float32_t)KER->Get(iin, index_in[j]);
           else
           {
-              for (j = 0; j < i; j++)
-                  if (incom[j] == -1)
-                      sp_D[i*chunk_size + j]
-                         = sp_y[i]*sp_y[j] * (float32_t)KER->Get(iin, index_in[j]);
+              for (c = 0; c < r; c++)
+                  if (incom[c] == -1)
+                  {
+                      sp_D[r*chunk_size + c]
+                         = sp_y[r]*sp_y[c] * (float32_t)KER->Eval(rin, index_in[c]);
+                      kevals += 1.0;
+                  }
                   else
-                      sp_D[i*chunk_size + j]
-                         = sp_D[incom[j]*chunk_size + incom[i]];
-              sp_D[i*chunk_size + i]
-                  = sp_y[i]*sp_y[i] * (float32_t)KER->Get(iin, index_in[i]);
+                      sp_D[r*chunk_size + c]
+                         = sp_D[incom[c]*chunk_size + incom[r]];
+              sp_D[r*chunk_size + r]
+                  = sp_y[r]*sp_y[r] * (float32_t)KER->Eval(rin, index_in[r]);
+              kevals += 1.0;
           }
       }
+      KER->KernelEvaluations += kevals;
       for (i = 0; i < chunk_size; i++)
       {
           for (j = 0; j < i; j++)
@@ -1097,18 +1254,28 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
       if (nit == 0 && PreprocessMode > 0)
       {
          for (i = 0; i < chunk_size; i++)
+             rowin[i] = Cache->GetRow(index_in[i]);
+
+         kevals = 0.0;
+#pragma omp parallel for num_threads(nparts) if (nparts > 1) reduction(+:kevals)
+         for (int32_t r = 0; r < chunk_size; r++)
          {
-             iin  = index_in[i];
-             aux  = 0.;
-             ptmw = Cache->GetRow(iin);
-             if (ptmw == NULL)
-                 for (j = 0; j < nzout; j++)
-                     aux += vau[j] * KER->Get(iin, indnzout[j]);
+             int32_t   rin  = index_in[r];
+             float64_t raux = 0.;
+             int32_t   c;
+
+             if (rowin[r] == NULL)
+             {
+                 for (c = 0; c < nzout; c++)
+                     raux += vau[c] * KER->Eval(rin, indnzout[c]);
+                 kevals += nzout;
+             }
              else
-                 for (j = 0; j < nzout; j++)
-                     aux += vau[j] * ptmw[indnzout[j]];
-             sp_h[i] = y_in(i) * aux - 1.0;
+                 for (c = 0; c < nzout; c++)
+                     raux += vau[c] * rowin[r][indnzout[c]];
+             sp_h[r] = y_in(r) * raux - 1.0;
          }
+         KER->KernelEvaluations += kevals;
       }
       else
       {
@@ -1254,17 +1421,24 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
 			}
 		}
 
-        for (i = 0; i < ell; i++)
-            st[i] += KER->get_kernel()->compute_optimized(i);
+        Kernel* kn = KER->get_kernel();
+#pragma omp parallel for num_threads(nparts) if (nparts > 1)
+        for (int32_t p = 0; p < nparts; p++)
+            for (int32_t r = displ[p]; r < displ[p] + recvl[p]; r++)
+                st[r] += kn->compute_optimized(r);
 	}
 	else  // nonlinear kernel
     {
+        /* compute the missing rows at once before using them */
+        Cache->FillRows(indnzin, nzin);
+        if (PreprocessMode > 0 && nit == 0)
+            Cache->FillRows(indnzout, nzout);
+
         k = Cache->DivideMP(ing, indnzin, nzin);
         for (j = 0; j < k; j++)
         {
             ptmw = Cache->FillRow(indnzin[ing[j]]);
-            for (i = 0; i < ell; i++)
-                st[i] += grad[ing[j]] * ptmw[i];
+            UpdateGradient(st, ptmw, grad[ing[j]], nparts, recvl, displ);
         }
 
         if (PreprocessMode > 0 && nit == 0)
@@ -1276,8 +1450,7 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
             {
                 jin  = indnzout[j];
                 ptmw = Cache->FillRow(jin);
-                for (i = 0; i < ell; i++)
-                    st[i] += alpha[jin] * y[jin] * ptmw[i];
+                UpdateGradient(st, ptmw, alpha[jin] * y[jin], nparts, recvl, displ);
             }
             if (verbosity > 1)
                 io::info(
@@ -1379,6 +1552,11 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
   SG_FREE(sp_y);
   SG_FREE(sp_D);
   SG_FREE(sp_alpha);
+  SG_FREE(rowin);
+
+  cache_hits      = Cache->Hits();
+  cache_misses    = Cache->Misses();
+  cache_evictions = Cache->Evictions();
   delete Cache;
 
   aux = KER->KernelEvaluations;
@@ -1398,6 +1576,9 @@ float64_t QPproblem::gpdtsolve(float64_t *solution)
               "- Total inner solver time: {}", tot_vpm_time);
       io::info(
               "- Total gradient updating time: {}", tot_st_time);
+      io::info(
+              "- Cache hits: {}, misses: {}, evictions: {}",
+              cache_hits, cache_misses, cache_evictions);
   }
   io::info("- Objective function value: {}", fval);
   objective_value=fval;
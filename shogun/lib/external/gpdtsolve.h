@@ -78,6 +78,16 @@ public:
   float64_t  tau_proximal;
   /** objective value */
   float64_t objective_value;
+  /** number of threads used by pgpdtsolve */
+  int32_t     nthreads;
+  /** store the cached kernel rows as float32 instead of float64 */
+  bool        float32_cache;
+  /** kernel row cache hits of the last solve */
+  int64_t     cache_hits;
+  /** kernel row cache misses of the last solve */
+  int64_t     cache_misses;
+  /** kernel row cache evictions of the last solve */
+  int64_t     cache_evictions;
 
 // ----------------- Public Methods ---------------
   /** constructor */
@@ -113,8 +123,12 @@ public:
    */
   static void copy_subproblem(QPproblem* dst, QPproblem* ker, int32_t len, int32_t *perm);
 
-  /** PrepMP */
-  void PrepMP         ();
+  /** split the ell components into nparts contiguous parts, one per
+   * thread (sizes in recvl, offsets in displ)
+   *
+   * @param parts number of parts, at most 32
+   */
+  void PrepMP         (int32_t parts);
 
   /** solve gpdt
    *
@@ -123,7 +137,8 @@ public:
    */
   float64_t  gpdtsolve      (float64_t *solution);
 
-  /** solve pgpdt
+  /** solve pgpdt, the shared memory parallel variant of gpdtsolve using
+   * nthreads threads for the kernel evaluations and the gradient updates
    *
    * @param solution
    * @return something floaty
@@ -150,8 +165,7 @@ private:
   int32_t    *cec;
   int32_t    nb;
   int32_t    *bmem, *bmemrid, *pbmr;
-  int32_t    my_chunk_size;  // chunk_size for the current processor
-  int32_t    my_spD_offset;  // offset of the current processor into sp_D matrix
+  int32_t    nparts;         // number of threads of the current solve
   int32_t    recvl[32], displ[32];
   float64_t kktold;
   float64_t DELTAvpm, InitialDELTAvpm, DELTAkin;
@@ -163,6 +177,8 @@ private:
   int32_t  Preprocess0 (int32_t *aux, int32_t *sv);
   int32_t  Preprocess1 (sKernel* KER, int32_t *aux, int32_t *sv);
   int32_t  optimal     ();
+  template <class T>
+  float64_t solve     (float64_t *solution, int32_t parts);
 
   bool is_zero(int32_t  i) { return (alpha[i] < DELTAsv); }
   bool is_free(int32_t  i)
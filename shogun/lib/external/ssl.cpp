@@ -21,11 +21,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 #include <algorithm>
 
 #include <shogun/io/SGIO.h>
 #include <shogun/mathematics/Math.h>
 #include <shogun/features/SparseFeatures.h>
+#include <shogun/lib/SGMatrix.h>
 #include <shogun/lib/external/ssl.h>
 
 namespace shogun
@@ -76,6 +78,52 @@ void ssl_train(struct data *Data,
 	return;
 }
 
+/* r[0..n-1] += sum_{j<active} z[j]*[x_J[j]; bias]. With several threads
+   every thread sums a contiguous block of examples into its own column of
+   buf (n x threads), the columns are then added to r in a fixed order. */
+static void add_subset_to_dense_vec(
+	DotFeatures* features, const struct options *Options,
+	const float64_t *z, const int32_t *J, int32_t active,
+	float64_t *r, int32_t n, SGMatrix<float64_t>& buf)
+{
+	int32_t num_threads = Math::min(Options->num_threads, active);
+
+	if (num_threads <= 1)
+	{
+		for (int32_t j=0; j < active; j++)
+		{
+			features->add_to_dense_vec(z[j], J[j], r, n-1);
+			r[n-1]+=Options->bias*z[j]; //bias (modelled as last dim)
+		}
+		return;
+	}
+
+	if (buf.num_rows != n || buf.num_cols < num_threads)
+		buf = SGMatrix<float64_t>(n, num_threads);
+
+	#pragma omp parallel for num_threads(num_threads)
+	for (int32_t k=0; k < num_threads; k++)
+	{
+		float64_t *rk = buf.get_column_vector(k);
+		int32_t first = int64_t(active)*k/num_threads;
+		int32_t last = int64_t(active)*(k+1)/num_threads;
+
+		memset(rk, 0, sizeof(float64_t)*n);
+		for (int32_t j=first; j < last; j++)
+		{
+			features->add_to_dense_vec(z[j], J[j], rk, n-1);
+			rk[n-1]+=Options->bias*z[j]; //bias (modelled as last dim)
+		}
+	}
+
+	#pragma omp parallel for num_threads(num_threads)
+	for (int32_t i=0; i < n; i++)
+	{
+		for (int32_t k=0; k < num_threads; k++)
+			r[i]+=buf(i, k);
+	}
+}
+
 int32_t CGLS(
 	const struct data *Data, const struct options *Options,
 	const struct vector_int *Subset, struct vector_double *Weights,
@@ -106,11 +154,9 @@ int32_t CGLS(
 	SGVector<float64_t> r(n);
 	for (int32_t i = n ; i-- ;)
 		r[i] = 0.0;
-	for (int32_t j=0; j < active; j++)
-	{
-		features->add_to_dense_vec(z[j], J[j], r, n-1);
-		r[n-1]+=Options->bias*z[j]; //bias (modelled as last dim)
-	}
+	// per thread partial sums of r, allocated once for all iterations
+	SGMatrix<float64_t> rbuf;
+	add_subset_to_dense_vec(features, Options, z, J, active, r, n, rbuf);
 	SGVector<float64_t> p(n);
 	float64_t omega1 = 0.0;
 	for (int32_t i = n ; i-- ;)
@@ -133,17 +179,19 @@ int32_t CGLS(
 	{
 		cgiter++;
 		omega_q=0.0;
-		float64_t t=0.0;
-		int32_t i,j;
-		// #pragma omp parallel for private(i,j)
-		for (i=0; i < active; i++)
+		int32_t i;
+		SGVector<float64_t> p_feat=p.slice(0, n-1);
+		#pragma omp parallel for num_threads(Options->num_threads) \
+			if (Options->num_threads > 1)
+		for (int32_t k=0; k < active; k++)
 		{
-			ii=J[i];
-			t=features->dot(ii, p.slice(0, n-1));
+			float64_t t=features->dot(J[k], p_feat);
 			t+=Options->bias*p[n-1]; //bias (modelled as last dim)
-			q[i]=t;
-			omega_q += C[ii]*t*t;
+			q[k]=t;
 		}
+		// summed in order to match the single threaded result
+		for (i=0; i < active; i++)
+			omega_q += C[J[i]]*q[i]*q[i];
 		gamma = omega1/(lambda*omega_p + omega_q);
 		inv_omega2 = 1/omega1;
 		for (i = n ; i-- ;)
@@ -159,13 +207,7 @@ int32_t CGLS(
 			z[i] -= gamma*C[ii]*q[i];
 			omega_z+=z[i]*z[i];
 		}
-		for (j=0; j < active; j++)
-		{
-			t=z[j];
-
-			features->add_to_dense_vec(t, J[j], r, n-1);
-			r[n-1]+=Options->bias*t; //bias (modelled as last dim)
-		}
+		add_subset_to_dense_vec(features, Options, z, J, active, r, n, rbuf);
 		omega1 = 0.0;
 		for (i = n ; i-- ;)
 		{
@@ -251,7 +293,6 @@ int32_t L2_SVM_MFN(
 	Weights_bar->d=n;
 	Outputs_bar->d=m;
 	float64_t delta=0.0;
-	float64_t t=0.0;
 	int32_t ii = 0;
 	while(iter<MFNITERMAX)
 	{
@@ -263,14 +304,14 @@ int32_t L2_SVM_MFN(
 			o_bar[i]=o[i];
 
 		opt=CGLS(Data,Options,ActiveSubset,Weights_bar,Outputs_bar);
+		SGVector<float64_t> w_feat=w_bar.slice(0, n-1);
+		#pragma omp parallel for num_threads(Options->num_threads) \
+			if (Options->num_threads > 1)
 		for(int32_t i=active; i < m; i++)
 		{
-			ii=ActiveSubset->vec[i];
-
-			t=features->dot(ii, w_bar.slice(0, n-1));
-			t+=Options->bias*w_bar[n-1]; //bias (modelled as last dim)
-
-			o_bar[ii]=t;
+			int32_t jj=ActiveSubset->vec[i];
+			o_bar[jj]=features->dot(jj, w_feat)
+				+Options->bias*w_bar[n-1]; //bias (modelled as last dim)
 		}
 		if(ini==0) {Options->cgitermax=CGITERMAX; ini=1;};
 		opt2=1;
@@ -450,14 +491,22 @@ int32_t TSVM_MFN(
 	float64_t *ou = SG_MALLOC(float64_t, Data->u);
 	float64_t lambda_0 = TSVM_LAMBDA_SMALL;
 	SGVector<float64_t> weights_sgvec(Weights->vec, Weights->d, false);
+	SGVector<float64_t> weights_feat=weights_sgvec.slice(0, Data->n-1);
+	#pragma omp parallel for num_threads(Options->num_threads) \
+		if (Options->num_threads > 1)
 	for (int32_t i=0;i<Data->m;i++)
 	{
 		if(Data->Y[i]==0.0)
 		{
-			t=Data->features->dot(i, weights_sgvec.slice(0, Data->n-1));
-			t+=Options->bias*Weights->vec[Data->n-1]; //bias (modelled as last dim)
-
-			Outputs->vec[i]=t;
+			Outputs->vec[i]=Data->features->dot(i, weights_feat)
+				+Options->bias*Weights->vec[Data->n-1]; //bias (modelled as last dim)
+		}
+	}
+	for (int32_t i=0;i<Data->m;i++)
+	{
+		if(Data->Y[i]==0.0)
+		{
+			t=Outputs->vec[i];
 			Data->C[i]=lambda_0*1.0/Data->u;
 			JU[q]=i;
 			ou[q]=t;
@@ -759,7 +808,6 @@ int32_t optimize_w(
 	Weights_bar->d=n;
 	Outputs_bar->d=m; /* read only the top m ; bottom u will be copies */
 	float64_t delta=0.0;
-	float64_t t=0.0;
 	int32_t ii = 0;
 	while(iter<MFNITERMAX)
 	{
@@ -771,13 +819,14 @@ int32_t optimize_w(
 		for(i=m+u; i-- ;)
 			o_bar[i]=o[i];
 		opt=CGLS(Data,Options,ActiveSubset,Weights_bar,Outputs_bar);
-		for(i=active; i < m; i++)
+		SGVector<float64_t> w_feat=w_bar.slice(0, n-1);
+		#pragma omp parallel for num_threads(Options->num_threads) \
+			if (Options->num_threads > 1)
+		for(int32_t k=active; k < m; k++)
 		{
-			ii=ActiveSubset->vec[i];
-			t=features->dot(ii, w_bar.slice(0, n-1));
-			t+=Options->bias*w_bar[n-1]; //bias (modelled as last dim)
-
-			o_bar[ii]=t;
+			int32_t jj=ActiveSubset->vec[k];
+			o_bar[jj]=features->dot(jj, w_feat)
+				+Options->bias*w_bar[n-1]; //bias (modelled as last dim)
 		}
 		// make o_bar consistent in the bottom half
 		j=0;
@@ -114,6 +114,9 @@ struct options
 
 	/** 1.0 if bias is to be used, 0.0 otherwise */
 	float64_t bias;
+
+	/** number of threads for the output and gradient computations */
+	int32_t num_threads;
 };
 
 /** used in line search */
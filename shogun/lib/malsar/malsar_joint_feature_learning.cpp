@@ -11,6 +11,7 @@
 
 #include <shogun/lib/malsar/malsar_joint_feature_learning.h>
 #ifdef USE_GPL_SHOGUN
+#include <shogun/lib/malsar/malsar_logistic.h>
 #include <shogun/lib/Signal.h>
 #include <shogun/mathematics/Math.h>
 #include <shogun/mathematics/eigen3.h>
@@ -44,9 +45,10 @@ malsar_result_t malsar_joint_feature_learning(
 	VectorXd Cs = VectorXd::Zero(n_tasks);
 	MatrixXd Wz=Ws, Wzp=Ws, Wz_old=Ws, delta_Wzp=Ws, gWs=Ws;
 	VectorXd Cz=Cs, Czp=Cs, Cz_old=Cs, delta_Czp=Cs, gCs=Cs;
-
-	SGMatrix<float64_t> Ws_sgmat(Ws.data(), n_feats, n_tasks, false);
-	SGMatrix<float64_t> Wzp_sgmat(Wzp.data(), n_feats, n_tasks, false);
+	// outputs of the vectors for the weights above, the outputs at the
+	// search point follow from the ones of the last two iterates
+	VectorXd As = VectorXd::Zero(n_vecs);
+	VectorXd Az=As, Azp=As, Az_old=As;
 
 	double t=1, t_old=0;
 	double gamma=1, gamma_inc=2;
@@ -64,30 +66,11 @@ malsar_result_t malsar_joint_feature_learning(
 		// compute search point
 		Ws = (1+alpha)*Wz - alpha*Wz_old;
 		Cs = (1+alpha)*Cz - alpha*Cz_old;
-
-		// zero gradient
-		gWs.setZero();
-		gCs.setZero();
+		As = (1+alpha)*Az - alpha*Az_old;
 
 		// compute gradient and objective at search point
-		double Fs = 0;
-		for (task=0; task<n_tasks; task++)
-		{
-			SGVector<index_t> task_idx = options.tasks_indices[task];
-			int n_task_vecs = task_idx.vlen;
-			for (int i=0; i<n_task_vecs; i++)
-			{
-				double aa = -y[task_idx[i]]*(features->dot(task_idx[i], Ws_sgmat.get_column(task))+Cs[task]);
-				double bb = Math::max(aa,0.0);
-
-				// avoid underflow when computing exponential loss
-				Fs += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)/n_task_vecs;
-				double b = -y[task_idx[i]]*(1 - 1/(1+std::exp(aa)))/n_task_vecs;
-
-				gCs[task] += b;
-				features->add_to_dense_vec(b, task_idx[i], gWs.col(task).data(), n_feats);
-			}
-		}
+		double Fs = malsar_logistic_loss(features, y, As.data(), Cs.data(), n_feats, options,
+		                                 gWs.data(), gCs.data());
 		gWs.noalias() += 2*rho2*Ws;
 
 		// add regularizer
@@ -123,19 +106,8 @@ malsar_result_t malsar_joint_feature_learning(
 			Czp = Cs - gCs/gamma;
 
 			// compute objective at line search point
-			Fzp = 0.0;
-			for (task=0; task<n_tasks; task++)
-			{
-				SGVector<index_t> task_idx = options.tasks_indices[task];
-				int n_task_vecs = task_idx.vlen;
-				for (int i=0; i<n_task_vecs; i++)
-				{
-					double aa = -y[task_idx[i]]*(features->dot(task_idx[i], Wzp_sgmat.get_column(task))+Czp[task]);
-					double bb = Math::max(aa,0.0);
-
-					Fzp += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)/n_task_vecs;
-				}
-			}
+			malsar_task_outputs(features, Wzp.data(), n_feats, Azp.data(), options);
+			Fzp = malsar_logistic_loss(features, y, Azp.data(), Czp.data(), n_feats, options, NULL, NULL);
 			Fzp += rho2*Wzp.squaredNorm();
 
 			// compute delta between line search point and search point
@@ -172,8 +144,10 @@ malsar_result_t malsar_joint_feature_learning(
 
 		Wz_old = Wz;
 		Cz_old = Cz;
+		Az_old = Az;
 		Wz = Wzp;
 		Cz = Czp;
+		Az = Azp;
 
 		// compute objective value
 		obj_old = obj;
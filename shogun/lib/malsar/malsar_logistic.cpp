@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Copyright (C) 2012 Jiayu Zhou and Jieping Ye
+ */
+
+#include <shogun/lib/malsar/malsar_logistic.h>
+#ifdef USE_GPL_SHOGUN
+#include <shogun/mathematics/Math.h>
+
+namespace shogun
+{
+
+void malsar_task_outputs(
+		const std::shared_ptr<DotFeatures>& features,
+		double* W, int n_feats, double* Aw,
+		const malsar_options& options)
+{
+	int n_tasks = options.n_tasks;
+
+	#pragma omp parallel for num_threads(options.n_threads) if (options.n_threads > 1) schedule(dynamic)
+	for (int task=0; task<n_tasks; task++)
+	{
+		SGVector<float64_t> w(W+task*n_feats, n_feats, false);
+		SGVector<index_t> task_idx = options.tasks_indices[task];
+		for (int i=0; i<task_idx.vlen; i++)
+			Aw[task_idx[i]] = features->dot(task_idx[i], w);
+	}
+}
+
+double malsar_logistic_loss(
+		const std::shared_ptr<DotFeatures>& features,
+		double* y, double* Aw, double* C, int n_feats,
+		const malsar_options& options,
+		double* gW, double* gC)
+{
+	int n_tasks = options.n_tasks;
+	SGVector<double> task_loss(n_tasks);
+
+	#pragma omp parallel for num_threads(options.n_threads) if (options.n_threads > 1) schedule(dynamic)
+	for (int task=0; task<n_tasks; task++)
+	{
+		SGVector<index_t> task_idx = options.tasks_indices[task];
+		int n_task_vecs = task_idx.vlen;
+		double* g = gW ? gW+task*n_feats : NULL;
+		if (g)
+		{
+			for (int j=0; j<n_feats; j++)
+				g[j] = 0.0;
+			gC[task] = 0.0;
+		}
+
+		double loss = 0.0;
+		for (int i=0; i<n_task_vecs; i++)
+		{
+			double aa = -y[task_idx[i]]*(Aw[task_idx[i]]+C[task]);
+			double bb = Math::max(aa,0.0);
+
+			// avoid underflow when computing exponential loss
+			loss += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)/n_task_vecs;
+			if (g)
+			{
+				double b = -y[task_idx[i]]*(1 - 1/(1+std::exp(aa)))/n_task_vecs;
+				gC[task] += b;
+				features->add_to_dense_vec(b, task_idx[i], g, n_feats);
+			}
+		}
+		task_loss[task] = loss;
+	}
+
+	double F = 0.0;
+	for (int task=0; task<n_tasks; task++)
+		F += task_loss[task];
+	return F;
+}
+
+};
+#endif //USE_GPL_SHOGUN
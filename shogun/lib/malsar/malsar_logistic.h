@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Copyright (C) 2012 Jiayu Zhou and Jieping Ye
+ */
+
+#ifndef  MALSAR_LOGISTIC_H_
+#define  MALSAR_LOGISTIC_H_
+#include <shogun/lib/config.h>
+#ifdef USE_GPL_SHOGUN
+#include <shogun/lib/malsar/malsar_options.h>
+#include <shogun/features/DotFeatures.h>
+
+namespace shogun
+{
+
+/**
+ * Computes the outputs of all vectors, each with the weight
+ * vector of its task. Tasks are processed in parallel by
+ * options.n_threads threads.
+ *
+ * @param features features
+ * @param W n_feats x n_tasks weight matrix
+ * @param n_feats dimension of the feature space
+ * @param Aw outputs of the vectors
+ * @param options options of solver
+ */
+void malsar_task_outputs(
+		const std::shared_ptr<DotFeatures>& features,
+		double* W, int n_feats, double* Aw,
+		const malsar_options& options);
+
+/**
+ * Computes the sum over tasks of the logistic loss of each task
+ * averaged over its vectors, given the outputs Aw of the vectors and
+ * the biases C of the tasks. If gW and gC are not NULL, the gradients
+ * of the loss with respect to the n_feats x n_tasks weight matrix and
+ * the biases are stored there. Tasks are processed in parallel by
+ * options.n_threads threads, their losses are summed in task order.
+ *
+ * @return loss
+ */
+double malsar_logistic_loss(
+		const std::shared_ptr<DotFeatures>& features,
+		double* y, double* Aw, double* C, int n_feats,
+		const malsar_options& options,
+		double* gW, double* gC);
+
+};
+#endif //USE_GPL_SHOGUN
+#endif   /* ----- #ifndef MALSAR_LOGISTIC_H_  ----- */
@@ -10,15 +10,76 @@
 
 #include <shogun/lib/malsar/malsar_low_rank.h>
 #ifdef USE_GPL_SHOGUN
+#include <shogun/lib/malsar/malsar_logistic.h>
 #include <shogun/mathematics/eigen3.h>
 #include <shogun/mathematics/Math.h>
 #include <iostream>
+#include <random>
 
 using namespace Eigen;
 
 namespace shogun
 {
 
+/* Orthonormal basis of the columns of Y */
+static MatrixXd orthonormal_basis(const MatrixXd& Y)
+{
+	HouseholderQR<MatrixXd> qr(Y);
+	return qr.householderQ()*MatrixXd::Identity(Y.rows(), Y.cols());
+}
+
+/* Computes the singular triplets M = U*diag(s)*V^T with singular values
+ * above threshold. The dominant right singular subspace is estimated by a
+ * randomized range finder with one power iteration, started from the
+ * right singular vectors V of the previous call extended by a few random
+ * directions. The rank is doubled until the smallest estimated singular
+ * value falls below the threshold, which makes the result exact once the
+ * rank reaches the number of columns of M. On return V holds the kept
+ * right singular vectors and is the warm start of the next call.
+ */
+static void partial_svd(const MatrixXd& M, double threshold,
+                        MatrixXd& U, VectorXd& s, MatrixXd& V,
+                        std::mt19937_64& prng)
+{
+	const int oversampling = 5;
+	int n = M.cols();
+	int k = Math::min(n, (int)V.cols()+oversampling);
+	std::normal_distribution<double> normal;
+
+	while (true)
+	{
+		MatrixXd omega(n, k);
+		int n_warm = Math::min((int)V.cols(), k);
+		omega.leftCols(n_warm) = V.leftCols(n_warm);
+		for (int j=n_warm; j<k; j++)
+		{
+			for (int i=0; i<n; i++)
+				omega(i,j) = normal(prng);
+		}
+
+		MatrixXd Q = orthonormal_basis(M*omega);
+		Q = orthonormal_basis(M*(M.transpose()*Q));
+
+		// M ~ Q*Q^T*M = Q*(M^T*Q)^T, the SVD of the small n x k factor
+		// gives the SVD of the approximation
+		JacobiSVD<MatrixXd> svd(M.transpose()*Q, ComputeThinU | ComputeThinV);
+		s = svd.singularValues();
+		if (k==n || s[k-1] <= threshold)
+		{
+			int r = 0;
+			while (r<k && s[r] > threshold)
+				r++;
+			U = Q*svd.matrixV().leftCols(r);
+			V = svd.matrixU().leftCols(r);
+			s.conservativeResize(r);
+			return;
+		}
+
+		V = svd.matrixU();
+		k = Math::min(n, 2*k);
+	}
+}
+
 malsar_result_t malsar_low_rank(
 		const std::shared_ptr<DotFeatures>& features,
 		double* y,
@@ -40,6 +101,10 @@ malsar_result_t malsar_low_rank(
 	VectorXd Cs = VectorXd::Zero(n_tasks);
 	MatrixXd Wz=Ws, Wzp=Ws, Wz_old=Ws, delta_Wzp=Ws, gWs=Ws;
 	VectorXd Cz=Cs, Czp=Cs, Cz_old=Cs, delta_Czp=Cs, gCs=Cs;
+	// outputs of the vectors for the weights above, the outputs at the
+	// search point follow from the ones of the last two iterates
+	VectorXd As = VectorXd::Zero(n_vecs);
+	VectorXd Az=As, Azp=As, Az_old=As;
 
 	double t=1, t_old=0;
 	double gamma=1, gamma_inc=2;
@@ -47,6 +112,12 @@ malsar_result_t malsar_low_rank(
 
 	double rho_L2 = 0.0;
 
+	// truncated SVD of the last projection, its right singular vectors
+	// warm start the next one
+	MatrixXd svd_U, svd_V(n_tasks, 0);
+	VectorXd svd_s;
+	std::mt19937_64 prng(0);
+
 	//internal::set_is_malloc_allowed(false);
 	bool done = false;
 	while (!done && iter <= options.max_iter)
@@ -56,32 +127,11 @@ malsar_result_t malsar_low_rank(
 		// compute search point
 		Ws = (1+alpha)*Wz - alpha*Wz_old;
 		Cs = (1+alpha)*Cz - alpha*Cz_old;
-
-		SGMatrix<float64_t> Ws_sgmat(Ws.data(), n_feats, n_tasks, false);
-
-		// zero gradient
-		gWs.setZero();
-		gCs.setZero();
+		As = (1+alpha)*Az - alpha*Az_old;
 
 		// compute gradient and objective at search point
-		double Fs = 0;
-		for (task=0; task<n_tasks; task++)
-		{
-			SGVector<index_t> task_idx = options.tasks_indices[task];
-			int n_task_vecs = task_idx.vlen;
-			for (int i=0; i<n_task_vecs; i++)
-			{
-				double aa = -y[task_idx[i]]*(features->dot(task_idx[i], Ws_sgmat.get_column(task))+Cs[task]);
-				double bb = Math::max(aa,0.0);
-
-				// avoid underflow when computing exponential loss
-				Fs += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)/n_task_vecs;
-				double b = -y[task_idx[i]]*(1 - 1/(1+std::exp(aa)))/n_task_vecs;
-
-				gCs[task] += b;
-				features->add_to_dense_vec(b, task_idx[i], gWs.col(task).data(), n_feats);
-			}
-		}
+		double Fs = malsar_logistic_loss(features, y, As.data(), Cs.data(), n_feats, options,
+		                                 gWs.data(), gCs.data());
 		gWs.noalias() += 2*rho_L2*Ws;
 		//SG_DEBUG("gWs={}",gWs.squaredNorm())
 
@@ -96,34 +146,15 @@ malsar_result_t malsar_low_rank(
 		{
 			// compute trace projection of Ws - gWs/gamma with 2*rho/gamma
 			//internal::set_is_malloc_allowed(true);
-			Wzp.setZero();
-			JacobiSVD<MatrixXd> svd((Ws - gWs/gamma).transpose(),ComputeThinU | ComputeThinV);
-			for (int i=0; i<svd.singularValues().size(); i++)
-			{
-				if (svd.singularValues()[i] > rho/gamma)
-					Wzp += (svd.matrixU().col(i)*
-					       svd.singularValues()[i]*
-					       svd.matrixV().col(i).transpose()).transpose();
-			}
+			partial_svd(Ws - gWs/gamma, rho/gamma, svd_U, svd_s, svd_V, prng);
+			Wzp.noalias() = svd_U*svd_s.asDiagonal()*svd_V.transpose();
 			//internal::set_is_malloc_allowed(false);
 			// walk in direction of antigradient
 			Czp = Cs - gCs/gamma;
 
 			// compute objective at line search point
-			Fzp = 0.0;
-			SGMatrix<float64_t> Wzp_sgmat(Wzp.data(), n_feats, n_tasks, false);
-			for (task=0; task<n_tasks; task++)
-			{
-				SGVector<index_t> task_idx = options.tasks_indices[task];
-				int n_task_vecs = task_idx.vlen;
-				for (int i=0; i<n_task_vecs; i++)
-				{
-					double aa = -y[task_idx[i]]*(features->dot(task_idx[i], Wzp_sgmat.get_column(task))+Czp[task]);
-					double bb = Math::max(aa,0.0);
-
-					Fzp += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)/n_task_vecs;
-				}
-			}
+			malsar_task_outputs(features, Wzp.data(), n_feats, Azp.data(), options);
+			Fzp = malsar_logistic_loss(features, y, Azp.data(), Czp.data(), n_feats, options, NULL, NULL);
 			Fzp += rho_L2*Wzp.squaredNorm();
 
 			// compute delta between line search point and search point
@@ -157,16 +188,16 @@ malsar_result_t malsar_low_rank(
 
 		Wz_old = Wz;
 		Cz_old = Cz;
+		Az_old = Az;
 		Wz = Wzp;
 		Cz = Czp;
+		Az = Azp;
 
 		// compute objective value
 		obj_old = obj;
 		obj = Fzp;
-		//internal::set_is_malloc_allowed(true);
-		JacobiSVD<MatrixXd> svd(Wzp, EigenvaluesOnly);
-		obj += rho*svd.singularValues().sum();
-		//internal::set_is_malloc_allowed(false);
+		// the singular values of Wzp are the ones kept by the projection
+		obj += rho*svd_s.sum();
 
 
 		// check if process should be terminated
@@ -38,6 +38,7 @@ IGNORE_IN_CLASSLIST struct malsar_options
 	int n_clusters;
 	SGVector<int>* tasks_indices;
 	malsar_loss loss;
+	int n_threads;
 
 	static malsar_options default_options()
 	{
@@ -48,6 +49,7 @@ IGNORE_IN_CLASSLIST struct malsar_options
 		opts.tasks_indices = NULL;
 		opts.n_clusters = 2;
 		opts.loss = MALSAR_LOGISTIC;
+		opts.n_threads = 1;
 		return opts;
 	}
 };
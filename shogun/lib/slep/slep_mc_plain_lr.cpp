@@ -11,6 +11,7 @@
 #include <shogun/lib/slep/slep_mc_plain_lr.h>
 #ifdef USE_GPL_SHOGUN
 
+#include <shogun/lib/slep/slep_solver.h>
 #include <shogun/lib/slep/q1/eppMatrix.h>
 #include <shogun/mathematics/Math.h>
 #include <shogun/mathematics/eigen3.h>
@@ -25,6 +26,143 @@ using namespace std;
 namespace shogun
 {
 
+/* Whether the features can be iterated over nonzeros. Only dense and
+ * sparse real features are known to implement the iterator, other dot
+ * features may only provide dot products.
+ */
+static bool has_feature_iterator(const std::shared_ptr<DotFeatures>& features)
+{
+	EFeatureClass fclass = features->get_feature_class();
+	return (fclass == C_DENSE || fclass == C_SPARSE) &&
+		features->get_feature_type() == F_DREAL;
+}
+
+/* Computes the outputs of all classes for all vectors in a single pass
+ * over the features. wt holds a column of class weights per feature and
+ * At gets a column of class outputs per vector, vectors are processed in
+ * blocks by several threads. Other features get one dense_dot_range
+ * pass per class instead.
+ */
+static void compute_outputs(const std::shared_ptr<DotFeatures>& features,
+                            const MatrixXd& wt, MatrixXd& At, int n_threads)
+{
+	int n_classes = At.rows();
+	int n_vecs = At.cols();
+
+	if (!has_feature_iterator(features))
+	{
+		int n_feats = wt.cols();
+		VectorXd w(n_feats);
+		VectorXd out(n_vecs);
+		for (int j=0; j<n_classes; j++)
+		{
+			w = wt.row(j).transpose();
+			features->dense_dot_range(out.data(), 0, n_vecs, NULL, w.data(), n_feats, 0.0);
+			At.row(j) = out.transpose();
+		}
+		return;
+	}
+
+	#pragma omp parallel for num_threads(n_threads) if (n_threads > 1) schedule(static)
+	for (int i=0; i<n_vecs; i++)
+	{
+		At.col(i).setZero();
+		int32_t idx;
+		float64_t value;
+		void* it = features->get_feature_iterator(i);
+		while (features->get_next_feature(idx, value, it))
+			At.col(i) += value*wt.col(idx);
+		features->free_feature_iterator(it);
+	}
+}
+
+/* Computes the per class logistic losses of all vectors given the outputs
+ * At and the intercepts c, and their derivatives with respect to the
+ * outputs into B. Returns the sum of the losses taken in vector order.
+ */
+static double compute_losses(const MatrixXd& At, const VectorXd& c,
+                             const SGVector<float64_t>& labels_vector,
+                             MatrixXd* B, int n_threads)
+{
+	int n_classes = At.rows();
+	int n_vecs = At.cols();
+	VectorXd losses(n_vecs);
+
+	#pragma omp parallel for num_threads(n_threads) if (n_threads > 1) schedule(static)
+	for (int i=0; i<n_vecs; i++)
+	{
+		// class of current vector
+		int vec_class = labels_vector[i];
+		double loss = 0.0;
+		for (int j=0; j<n_classes; j++)
+		{
+			// compute logistic loss
+			double aa = ((vec_class == j) ? -1.0 : 1.0)*(At(j,i) + c(j));
+			double bb = aa > 0.0 ? aa : 0.0;
+			// avoid underflow via log-sum-exp trick
+			loss += std::log(std::exp(-bb) + std::exp(aa-bb)) + bb;
+			if (B)
+			{
+				double prob = 1.0/(1+std::exp(aa));
+				(*B)(j,i) = ((vec_class == j) ? -1.0 : 1.0)*(1-prob);
+			}
+		}
+		losses[i] = loss;
+	}
+	return losses.sum();
+}
+
+/* Computes gt = sum_i B.col(i)*x_i^T, a column of class gradients per
+ * feature. Every thread accumulates a contiguous range of classes over
+ * all vectors so no thread private copies of the gradient are needed and
+ * the result does not depend on the number of threads. The price is that
+ * each thread reads all the vectors, so feature reads grow with the
+ * number of threads. Other features are added per class
+ * with add_to_dense_vec.
+ */
+static void compute_gradient(const std::shared_ptr<DotFeatures>& features,
+                             const MatrixXd& B, MatrixXd& gt, int n_threads)
+{
+	int n_classes = B.rows();
+	int n_vecs = B.cols();
+	int n_parts = Math::min(n_threads, n_classes);
+	int part = (n_classes+n_parts-1)/n_parts;
+	gt.setZero();
+
+	if (!has_feature_iterator(features))
+	{
+		int n_feats = gt.cols();
+		VectorXd g(n_feats);
+		for (int j=0; j<n_classes; j++)
+		{
+			g.setZero();
+			for (int i=0; i<n_vecs; i++)
+				features->add_to_dense_vec(B(j,i), i, g.data(), n_feats);
+			gt.row(j) = g.transpose();
+		}
+		return;
+	}
+
+	#pragma omp parallel for num_threads(n_parts) if (n_parts > 1)
+	for (int k=0; k<n_parts; k++)
+	{
+		int start = k*part;
+		int len = Math::min(n_classes, start+part) - start;
+		if (len<=0)
+			continue;
+
+		for (int i=0; i<n_vecs; i++)
+		{
+			int32_t idx;
+			float64_t value;
+			void* it = features->get_feature_iterator(i);
+			while (features->get_next_feature(idx, value, it))
+				gt.col(idx).segment(start, len) += value*B.col(i).segment(start, len);
+			features->free_feature_iterator(it);
+		}
+	}
+}
+
 slep_result_t slep_mc_plain_lr(
 		const std::shared_ptr<DotFeatures>& features,
 		const std::shared_ptr<MulticlassLabels>& labels,
@@ -64,14 +202,18 @@ slep_result_t slep_mc_plain_lr(
 	MatrixXd search_w = MatrixXd::Zero(n_feats, n_classes);
 	// search point intercepts
 	VectorXd search_c = VectorXd::Zero(n_classes);
-	// dot products
-	MatrixXd Aw  = MatrixXd::Zero(n_vecs, n_classes);
-	for (j=0; j<n_classes; j++)
-		features->dense_dot_range(Aw.col(j).data(), 0, n_vecs, NULL, w.col(j).data(), n_feats, 0.0);
-	MatrixXd As  = MatrixXd::Zero(n_vecs, n_classes);
-	MatrixXd Awp = MatrixXd::Zero(n_vecs, n_classes);
+	// transposed weights, a column per feature
+	MatrixXd wt = w.transpose();
+	// dot products, a column per vector
+	MatrixXd Aw  = MatrixXd::Zero(n_classes, n_vecs);
+	compute_outputs(features, wt, Aw, options.n_threads);
+	MatrixXd As  = MatrixXd::Zero(n_classes, n_vecs);
+	MatrixXd Awp = MatrixXd::Zero(n_classes, n_vecs);
+	// derivatives of the losses with respect to the dot products
+	MatrixXd B   = MatrixXd::Zero(n_classes, n_vecs);
 	// gradients
 	MatrixXd g   = MatrixXd::Zero(n_feats, n_classes);
+	MatrixXd gt  = MatrixXd::Zero(n_classes, n_feats);
 	VectorXd gc  = VectorXd::Zero(n_classes);
 	// projection
 	MatrixXd v   = MatrixXd::Zero(n_feats, n_classes);
@@ -103,30 +245,12 @@ slep_result_t slep_mc_plain_lr(
 		As = Aw + beta*(Aw-Awp);
 
 		// compute objective and gradient at search point
-		double fun_s = 0;
-		g.setZero();
-		gc.setZero();
-		// for each vector
-		for (i=0; i<n_vecs; i++)
-		{
-			// class of current vector
-			int vec_class = labels_vector[i];
-			// for each class
-			for (j=0; j<n_classes; j++)
-			{
-				// compute logistic loss
-				double aa = ((vec_class == j) ? -1.0 : 1.0)*(As(i,j) + search_c(j));
-				double bb = aa > 0.0 ? aa : 0.0;
-				// avoid underflow via log-sum-exp trick
-				fun_s += std::log(std::exp(-bb) + std::exp(aa-bb)) + bb;
-				double prob = 1.0/(1+std::exp(aa));
-				double b = ((vec_class == j) ? -1.0 : 1.0)*(1-prob);///(n_vecs*n_classes);
-				// update gradient of intercepts
-				gc[j] += b;
-				// update gradient of weight vectors
-				features->add_to_dense_vec(b, i, g.col(j).data(), n_feats);
-			}
-		}
+		double fun_s = compute_losses(As, search_c, labels_vector, &B, options.n_threads);
+		// update gradient of intercepts
+		gc = B.rowwise().sum();
+		// update gradient of weight vectors
+		compute_gradient(features, B, gt, options.n_threads);
+		g = gt.transpose();
 		//fun_s /= (n_vecs*n_classes);
 
 		wp = w;
@@ -146,24 +270,24 @@ slep_result_t slep_mc_plain_lr(
 			// compute projection of gradient
 			eppMatrix(w.data(),v.data(),n_feats,n_classes,lambda/L,options.q);
 
+			// features discarded by screening stay zero
+			if (options.active)
+			{
+				for (j=0; j<n_feats; j++)
+				{
+					if (!options.active[j])
+						w.row(j).setZero();
+				}
+			}
+
 			v = w - search_w;
 
 			// update dot products
-			for (j=0; j<n_classes; j++)
-				features->dense_dot_range(Aw.col(j).data(), 0, n_vecs, NULL, w.col(j).data(), n_feats, 0.0);
+			wt = w.transpose();
+			compute_outputs(features, wt, Aw, options.n_threads);
 
 			// compute objective at search point
-			fun_x = 0;
-			for (i=0; i<n_vecs; i++)
-			{
-				int vec_class = labels_vector[i];
-				for (j=0; j<n_classes; j++)
-				{
-					double aa = ((vec_class == j) ? -1.0 : 1.0)*(Aw(i,j) + c(j));
-					double bb = aa > 0.0 ? aa : 0.0;
-					fun_x += std::log(std::exp(-bb) + std::exp(aa-bb)) + bb;
-				}
-			}
+			fun_x = compute_losses(Aw, c, labels_vector, NULL, options.n_threads);
 			//fun_x /= (n_vecs*n_classes);
 
 			// check for termination of line search
@@ -231,6 +355,78 @@ slep_result_t slep_mc_plain_lr(
 		r_c[j] = c[j];
 	return slep_result_t(r_w, r_c);
 };
+
+/* Gradient of the loss at the given solution, a column per class */
+static SGMatrix<double> loss_gradient(const std::shared_ptr<DotFeatures>& features,
+                                      const SGVector<float64_t>& labels_vector,
+                                      const slep_result_t& result, int n_threads)
+{
+	int n_feats = result.w.num_rows;
+	int n_classes = result.w.num_cols;
+	int n_vecs = features->get_num_vectors();
+
+	Map<MatrixXd> w(result.w.matrix, n_feats, n_classes);
+	Map<VectorXd> c(result.c.vector, n_classes);
+	MatrixXd wt = w.transpose();
+	MatrixXd Aw(n_classes, n_vecs);
+	compute_outputs(features, wt, Aw, n_threads);
+
+	MatrixXd B(n_classes, n_vecs);
+	compute_losses(Aw, c, labels_vector, &B, n_threads);
+	MatrixXd gt(n_classes, n_feats);
+	compute_gradient(features, B, gt, n_threads);
+
+	SGMatrix<double> g(n_feats, n_classes);
+	Map<MatrixXd>(g.matrix, n_feats, n_classes) = gt.transpose();
+	return g;
+}
+
+std::vector<slep_result_t> slep_mc_plain_lr_path(
+		const std::shared_ptr<DotFeatures>& features,
+		const std::shared_ptr<MulticlassLabels>& labels,
+		const SGVector<float64_t>& z,
+		const slep_options& options)
+{
+	SGVector<float64_t> labels_vector = labels->get_labels();
+
+	// the weights are regularized by the L1/Lq norm of their rows
+	slep_options path_options = options;
+	path_options.mode = MULTITASK_GROUP;
+	int n_feats = features->get_dim_feature_space();
+	SGVector<bool> active(n_feats);
+
+	std::vector<slep_result_t> path;
+	path.reserve(z.vlen);
+	for (int k=0; k<z.vlen; k++)
+	{
+		path_options.active = NULL;
+		if (k>0)
+		{
+			path_options.last_result = &path.back();
+			SGMatrix<double> grad = loss_gradient(features, labels_vector, path.back(), options.n_threads);
+			int n_active = slep_strong_rule(grad, z[k], z[k-1], path_options, active.vector);
+			SG_DEBUG("z = {}: {} of {} features pass the strong rule", z[k], n_active, n_feats)
+			path_options.active = active.vector;
+		}
+
+		slep_result_t result = slep_mc_plain_lr(features, labels, z[k], path_options);
+
+		// solve again if the strong rule discarded features active at the optimum
+		while (path_options.active)
+		{
+			SGMatrix<double> grad = loss_gradient(features, labels_vector, result, options.n_threads);
+			int n_violations = slep_kkt_check(grad, z[k], path_options, active.vector);
+			if (n_violations==0)
+				break;
+
+			SG_DEBUG("z = {}: {} features violate the KKT conditions", z[k], n_violations)
+			path_options.last_result = &result;
+			result = slep_mc_plain_lr(features, labels, z[k], path_options);
+		}
+		path.push_back(result);
+	}
+	return path;
+}
 };
 
 #endif //USE_GPL_SHOGUN
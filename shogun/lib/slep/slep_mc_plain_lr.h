@@ -16,6 +16,8 @@
 #include <shogun/features/DotFeatures.h>
 #include <shogun/labels/MulticlassLabels.h>
 
+#include <vector>
+
 namespace shogun
 {
 
@@ -33,6 +35,22 @@ slep_result_t slep_mc_plain_lr(
 		float64_t z,
 		const slep_options& options);
 
+/** Solves the multiclass logistic regression problem for a decreasing
+ * sequence of regularization values with warm starts, discarding the
+ * features that fail the sequential strong rule before each solve.
+ *
+ * @param features features to be used
+ * @param labels labels to be used
+ * @param z decreasing regularization values
+ * @param options options of solver
+ * @return solutions for the values of z
+ */
+std::vector<slep_result_t> slep_mc_plain_lr_path(
+		const std::shared_ptr<DotFeatures>& features,
+		const std::shared_ptr<MulticlassLabels>& labels,
+		const SGVector<float64_t>& z,
+		const slep_options& options);
+
 };
 #endif //USE_GPL_SHOGUN
 #endif /* SLEP_MC_PLAIN_LR_H_ */
@@ -74,6 +74,8 @@ IGNORE_IN_CLASSLIST struct slep_options
 	slep_loss loss;
 	slep_mode mode;
 	slep_result_t* last_result;
+	bool* active;
+	int n_threads;
 
 	static slep_options default_options()
 	{
@@ -91,9 +93,11 @@ IGNORE_IN_CLASSLIST struct slep_options
 		opts.G = NULL;
 		opts.rsL2 = 0.0;
 		opts.last_result = NULL;
+		opts.active = NULL;
 		opts.tasks_indices = NULL;
 		opts.loss = LOGISTIC;
 		opts.mode = MULTITASK_GROUP;
+		opts.n_threads = 1;
 		return opts;
 	}
 };
@@ -20,9 +20,143 @@
 #include <shogun/lib/slep/tree/general_altra.h>
 #include <shogun/lib/Signal.h>
 
+#include <vector>
+
 namespace shogun
 {
 
+/* Adds b[i]*x_idx[i] for i in [0,n) to the n_feats dimensional vector g,
+ * idx being NULL stands for the identity. The vectors are split into
+ * contiguous blocks accumulated into a buffer per thread, the buffers are
+ * then added to g in block order so the result does not depend on the
+ * thread schedule.
+ */
+static void add_to_dense_vec(const std::shared_ptr<DotFeatures>& features,
+                             const double* b, const index_t* idx, int n,
+                             double* g, int n_feats, int n_threads)
+{
+	int n_parts = Math::min(n_threads, n);
+	if (n_parts<=1)
+	{
+		for (int i=0; i<n; i++)
+			features->add_to_dense_vec(b[i], idx ? idx[i] : i, g, n_feats);
+		return;
+	}
+
+	SGMatrix<double> buf(n_feats, n_parts);
+	buf.zero();
+	int part = (n+n_parts-1)/n_parts;
+
+	#pragma omp parallel for num_threads(n_parts)
+	for (int k=0; k<n_parts; k++)
+	{
+		double* g_k = buf.get_column_vector(k);
+		int stop = Math::min(n, (k+1)*part);
+		for (int i=k*part; i<stop; i++)
+			features->add_to_dense_vec(b[i], idx ? idx[i] : i, g_k, n_feats);
+	}
+
+	#pragma omp parallel for num_threads(n_parts)
+	for (int j=0; j<n_feats; j++)
+	{
+		for (int k=0; k<n_parts; k++)
+			g[j] += buf(j,k);
+	}
+}
+
+/* Computes Aw[idx[i]] = <x_idx[i], w> for i in [0,n), idx being NULL
+ * stands for the identity.
+ */
+static void dot_range(const std::shared_ptr<DotFeatures>& features,
+                      const SGVector<double>& w, const index_t* idx, int n,
+                      double* Aw, int n_threads)
+{
+	#pragma omp parallel for num_threads(n_threads) if (n_threads > 1)
+	for (int i=0; i<n; i++)
+	{
+		int vec = idx ? idx[i] : i;
+		Aw[vec] = features->dot(vec, w);
+	}
+}
+
+/* Computes the logistic loss of the vectors idx[i], i in [0,n), and its
+ * derivative with respect to their outputs scaled by 1/n_vecs into b.
+ * Returns the unscaled sum of the losses, summed serially in order.
+ */
+static double logistic_loss(const double* As, double c, const double* y,
+                            const index_t* idx, int n, int n_vecs,
+                            double* b, int n_threads)
+{
+	SGVector<double> loss(n);
+
+	#pragma omp parallel for num_threads(n_threads) if (n_threads > 1)
+	for (int i=0; i<n; i++)
+	{
+		int vec = idx ? idx[i] : i;
+		double aa = -y[vec]*(As[vec]+c);
+		double bb = Math::max(aa,0.0);
+		loss[i] = std::log(std::exp(-bb) + std::exp(aa-bb)) + bb;
+		double prob = 1.0/(1.0+std::exp(aa));
+		b[i] = -y[vec]*(1.0-prob) / n_vecs;
+	}
+
+	double fun = 0.0;
+	for (int i=0; i<n; i++)
+		fun += loss[i];
+	return fun;
+}
+
+/* Returns the number of weight vectors and of regularized blocks */
+static void problem_size(const slep_options& options, int& n_tasks, int& n_blocks)
+{
+	switch (options.mode)
+	{
+		case MULTITASK_GROUP:
+		case MULTITASK_TREE:
+			n_tasks = options.n_tasks;
+			n_blocks = options.n_tasks;
+		break;
+		case FEATURE_GROUP:
+		case FEATURE_TREE:
+			n_tasks = 1;
+			n_blocks = options.n_feature_blocks;
+		break;
+		case PLAIN:
+		case FUSED:
+			n_tasks = 1;
+			n_blocks = 1;
+		break;
+	}
+}
+
+/* Computes the outputs Aw of all vectors, each with the weight vector
+ * of its task.
+ */
+static void compute_Aw(const std::shared_ptr<DotFeatures>& features,
+                       const SGMatrix<double>& w, double* Aw, int n_vecs,
+                       const slep_options& options)
+{
+	switch (options.mode)
+	{
+		case MULTITASK_GROUP:
+		case MULTITASK_TREE:
+		{
+			for (int t=0; t<options.n_tasks; t++)
+			{
+				SGVector<index_t> task_idx = options.tasks_indices[t];
+				dot_range(features, w.get_column(t), task_idx.vector, task_idx.vlen, Aw, options.n_threads);
+			}
+		}
+		break;
+		case FEATURE_GROUP:
+		case FEATURE_TREE:
+		case PLAIN:
+		case FUSED:
+			dot_range(features, w.get_column(0), NULL, n_vecs, Aw, options.n_threads);
+		break;
+	}
+}
+
 double compute_regularizer(double* w, double lambda, double lambda2, int n_vecs, int n_feats,
                            int n_blocks, const slep_options& options)
 {
@@ -139,11 +273,12 @@ double compute_lambda(
 				SGVector<index_t> task_idx = options.tasks_indices[t];
 				int n_vecs_task = task_idx.vlen;
 
+				SGVector<double> b(n_vecs_task);
+
 				switch (options.loss)
 				{
 					case LOGISTIC:
 					{
-						double b = 0.0;
 						int m1 = 0, m2 = 0;
 						for (int i=0; i<n_vecs_task; i++)
 						{
@@ -155,20 +290,20 @@ double compute_lambda(
 						for (int i=0; i<n_vecs_task; i++)
 						{
 							if (y[task_idx[i]]>0)
-								b = double(m1)/(m1+m2);
+								b[i] = double(m1)/(m1+m2);
 							else
-								b = -double(m2)/(m1+m2);
-
-							features->add_to_dense_vec(b,task_idx[i],ATx+t*n_feats,n_feats);
+								b[i] = -double(m2)/(m1+m2);
 						}
 					}
 					break;
 					case LEAST_SQUARES:
 					{
 						for (int i=0; i<n_vecs_task; i++)
-							features->add_to_dense_vec(y[task_idx[i]],task_idx[i],ATx+t*n_feats,n_feats);
+							b[i] = y[task_idx[i]];
 					}
 				}
+				add_to_dense_vec(features, b.vector, task_idx.vector, n_vecs_task,
+				                 ATx+t*n_feats, n_feats, options.n_threads);
 			}
 		}
 		break;
@@ -182,24 +317,20 @@ double compute_lambda(
 				case LOGISTIC:
 				{
 					int m1 = 0, m2 = 0;
-					double b = 0.0;
+					SGVector<double> b(n_vecs);
 					for (int i=0; i<n_vecs; i++)
 						y[i]>0 ? m1++ : m2++;
 
 					SG_DEBUG("# pos = {} , # neg = {}",m1,m2)
 
 					for (int i=0; i<n_vecs; i++)
-					{
-						y[i]>0 ? b=double(m2) / Math::sq(n_vecs) : b=-double(m1) / Math::sq(n_vecs);
-						features->add_to_dense_vec(b,i,ATx,n_feats);
-					}
+						y[i]>0 ? b[i]=double(m2) / Math::sq(n_vecs) : b[i]=-double(m1) / Math::sq(n_vecs);
+
+					add_to_dense_vec(features, b.vector, NULL, n_vecs, ATx, n_feats, options.n_threads);
 				}
 				break;
 				case LEAST_SQUARES:
-				{
-					for (int i=0; i<n_vecs; i++)
-						features->add_to_dense_vec(y[i],i,ATx,n_feats);
-				}
+					add_to_dense_vec(features, y, NULL, n_vecs, ATx, n_feats, options.n_threads);
 				break;
 			}
 		}
@@ -311,6 +442,42 @@ void projection(double* w, double* v, int n_feats, int n_blocks, double lambda,
 		break;
 	}
 
+	// groups discarded by screening stay zero
+	if (options.active)
+	{
+		switch (options.mode)
+		{
+			case MULTITASK_GROUP:
+				for (int i=0; i<n_feats; i++)
+				{
+					if (!options.active[i])
+					{
+						for (int t=0; t<n_blocks; t++)
+							w[i+t*n_feats] = 0.0;
+					}
+				}
+			break;
+			case FEATURE_GROUP:
+				for (int t=0; t<n_blocks; t++)
+				{
+					if (!options.active[t])
+					{
+						for (int i=options.ind[t]; i<options.ind[t+1]; i++)
+							w[i] = 0.0;
+					}
+				}
+			break;
+			case PLAIN:
+				for (int i=0; i<n_feats; i++)
+				{
+					if (!options.active[i])
+						w[i] = 0.0;
+				}
+			break;
+			default:
+				error("Screening is not supported for tree and fused regularization");
+		}
+	}
 }
 
 double search_point_gradient_and_objective(const std::shared_ptr<DotFeatures>& features, double* ATx, double* As,
@@ -324,32 +491,32 @@ double search_point_gradient_and_objective(const std::shared_ptr<DotFeatures>& f
 	{
 		case MULTITASK_GROUP:
 		case MULTITASK_TREE:
+			if (options.loss==LEAST_SQUARES)
+			{
+				for (int i=0; i<n_feats*n_tasks; i++)
+					g[i] = -ATx[i];
+			}
 			for (int t=0; t<n_tasks; t++)
 			{
 				SGVector<index_t> task_idx = options.tasks_indices[t];
 				int n_vecs_task = task_idx.vlen;
+				SGVector<double> b(n_vecs_task);
 				switch (options.loss)
 				{
 					case LOGISTIC:
+						fun_s += logistic_loss(As, sc[t], y, task_idx.vector, n_vecs_task,
+						                       n_vecs, b.vector, options.n_threads) / n_vecs;
 						gc[t] = 0.0;
 						for (int i=0; i<n_vecs_task; i++)
-						{
-							double aa = -y[task_idx[i]]*(As[task_idx[i]]+sc[t]);
-							double bb = Math::max(aa,0.0);
-							fun_s += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)/ n_vecs;
-							double prob = 1.0/(1.0+std::exp(aa));
-							double b = -y[task_idx[i]]*(1.0-prob) / n_vecs;
-							gc[t] += b;
-							features->add_to_dense_vec(b,task_idx[i],g+t*n_feats,n_feats);
-						}
+							gc[t] += b[i];
 					break;
 					case LEAST_SQUARES:
-						for (int i=0; i<n_feats*n_tasks; i++)
-							g[i] = -ATx[i];
 						for (int i=0; i<n_vecs_task; i++)
-							features->add_to_dense_vec(As[task_idx[i]],task_idx[i],g+t*n_feats,n_feats);
+							b[i] = As[task_idx[i]];
 					break;
 				}
+				add_to_dense_vec(features, b.vector, task_idx.vector, n_vecs_task,
+				                 g+t*n_feats, n_feats, options.n_threads);
 			}
 		break;
 		case FEATURE_GROUP:
@@ -359,38 +526,20 @@ double search_point_gradient_and_objective(const std::shared_ptr<DotFeatures>& f
 			switch (options.loss)
 			{
 				case LOGISTIC:
+				{
+					SGVector<double> b(n_vecs);
+					fun_s = logistic_loss(As, sc[0], y, NULL, n_vecs, n_vecs,
+					                      b.vector, options.n_threads) / n_vecs;
 					gc[0] = 0.0;
-
 					for (int i=0; i<n_vecs; i++)
-					{
-						double aa = -y[i]*(As[i]+sc[0]);
-						double bb = Math::max(aa,0.0);
-						fun_s += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb);
-						/*
-						if (y[i]>0)
-							fun_s += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)*pos_weight;
-						else
-							fun_s += (std::log(std::exp(-bb) + std::exp(aa-bb)) + bb)*neg_weight;
-						*/
-						double prob = 1.0/(1.0+std::exp(aa));
-						//double b = 0;
-						double b = -y[i]*(1.0-prob)/n_vecs;
-						/*
-						if (y[i]>0)
-							b = -y[i]*(1.0-prob)*pos_weight;
-						else
-							b = -y[i]*(1.0-prob)*neg_weight;
-						*/
-						gc[0] += b;
-						features->add_to_dense_vec(b,i,g,n_feats);
-					}
-					fun_s /= n_vecs;
+						gc[0] += b[i];
+					add_to_dense_vec(features, b.vector, NULL, n_vecs, g, n_feats, options.n_threads);
+				}
 				break;
 				case LEAST_SQUARES:
 					for (int i=0; i<n_feats; i++)
 						g[i] = -ATx[i];
-					for (int i=0; i<n_vecs; i++)
-						features->add_to_dense_vec(As[i],i,g,n_feats);
+					add_to_dense_vec(features, As, NULL, n_vecs, g, n_feats, options.n_threads);
 				break;
 			}
 		break;
@@ -413,25 +562,7 @@ slep_result_t slep_solver(
 
 	int n_blocks = 0;
 	int n_tasks = 0;
-
-	switch (options.mode)
-	{
-		case MULTITASK_GROUP:
-		case MULTITASK_TREE:
-			n_tasks = options.n_tasks;
-			n_blocks = options.n_tasks;
-		break;
-		case FEATURE_GROUP:
-		case FEATURE_TREE:
-			n_tasks = 1;
-			n_blocks = options.n_feature_blocks;
-		break;
-		case PLAIN:
-		case FUSED:
-			n_tasks = 1;
-			n_blocks = 1;
-		break;
-	}
+	problem_size(options, n_tasks, n_blocks);
 	SG_DEBUG("n_tasks = {}, n_blocks = {}",n_tasks,n_blocks)
 	SG_DEBUG("n_nodes = {}",options.n_nodes)
 
@@ -459,8 +590,9 @@ slep_result_t slep_solver(
 
 	if (options.last_result)
 	{
-		w = options.last_result->w;
-		c = options.last_result->c;
+		// the solver updates w and c in place
+		w = options.last_result->w.clone();
+		c = options.last_result->c.clone();
 	}
 
 	double* s = SG_CALLOC(double, n_feats*n_tasks);
@@ -471,31 +603,7 @@ slep_result_t slep_solver(
 	double* z0_flsa = SG_CALLOC(double, n_feats);
 
 	double* Aw = SG_CALLOC(double, n_vecs);
-	switch (options.mode)
-	{
-		case MULTITASK_GROUP:
-		case MULTITASK_TREE:
-		{
-			for (t=0; t<n_blocks; t++)
-			{
-				SGVector<index_t> task_idx = options.tasks_indices[t];
-				//task_idx.display_vector("task");
-				int n_vecs_task = task_idx.vlen;
-				for (i=0; i<n_vecs_task; i++)
-					Aw[task_idx[i]] = features->dot(task_idx[i],w.get_column(t));
-			}
-		}
-		break;
-		case FEATURE_GROUP:
-		case FEATURE_TREE:
-		case PLAIN:
-		case FUSED:
-		{
-			for (i=0; i<n_vecs; i++)
-				Aw[i] = features->dot(i,w.get_column(0));
-		}
-		break;
-	}
+	compute_Aw(features, w, Aw, n_vecs, options);
 
 	double* Av = SG_MALLOC(double, n_vecs);
 	double* As = SG_MALLOC(double, n_vecs);
@@ -576,9 +684,9 @@ slep_result_t slep_solver(
 					{
 						SGVector<index_t> task_idx = options.tasks_indices[t];
 						int n_vecs_task = task_idx.vlen;
+						dot_range(features, w.get_column(t), task_idx.vector, n_vecs_task, Aw, options.n_threads);
 						for (i=0; i<n_vecs_task; i++)
 						{
-							Aw[task_idx[i]] = features->dot(task_idx[i],w.get_column(t));
 							if (options.loss==LOGISTIC)
 							{
 								double aa = -y[task_idx[i]]*(Aw[task_idx[i]]+c[t]);
@@ -592,9 +700,9 @@ slep_result_t slep_solver(
 				case FEATURE_TREE:
 				case PLAIN:
 				case FUSED:
+					dot_range(features, w.get_column(0), NULL, n_vecs, Aw, options.n_threads);
 					for (i=0; i<n_vecs; i++)
 					{
-						Aw[i] = features->dot(i, w.get_column(0));
 						if (options.loss==LOGISTIC)
 						{
 							double aa = -y[i]*(Aw[i]+c[0]);
@@ -742,6 +850,185 @@ slep_result_t slep_solver(
 
 	return slep_result_t(w,c);
 };
+
+/* Gradient of the loss at the given solution, a column per task */
+static SGMatrix<double> loss_gradient(const std::shared_ptr<DotFeatures>& features,
+                                      double* ATx, double* y, const slep_result_t& result,
+                                      int n_vecs, int n_feats, int n_tasks,
+                                      const slep_options& options)
+{
+	SGVector<double> Aw(n_vecs);
+	Aw.zero();
+	compute_Aw(features, result.w, Aw.vector, n_vecs, options);
+
+	SGMatrix<double> g(n_feats, n_tasks);
+	g.zero();
+	SGVector<double> gc(n_tasks);
+	search_point_gradient_and_objective(features, ATx, Aw.vector, result.c.vector, y,
+	                                    n_vecs, n_feats, n_tasks, g.matrix, gc.vector, options);
+	return g;
+}
+
+/* Lq norm of n elements of x taken with the given stride */
+static double lq_norm(const double* x, int n, int stride, double q)
+{
+	double norm = 0.0;
+	if (q>1e6)
+	{
+		for (int i=0; i<n; i++)
+			norm = Math::max(norm, Math::abs(x[i*stride]));
+		return norm;
+	}
+
+	for (int i=0; i<n; i++)
+		norm += Math::pow(Math::abs(x[i*stride]), q);
+	return Math::pow(norm, 1.0/q);
+}
+
+/* Dual norm of the gradient of a group, the group is zero at the optimum
+ * for every lambda not less than it.
+ */
+static double group_dual_norm(const SGMatrix<double>& grad, int group,
+                              const slep_options& options)
+{
+	double q_bar = 0.0;
+	if (options.q==1)
+		q_bar = Math::ALMOST_INFTY;
+	else if (options.q>1e6)
+		q_bar = 1;
+	else
+		q_bar = options.q/(options.q-1);
+
+	switch (options.mode)
+	{
+		case MULTITASK_GROUP:
+			return lq_norm(grad.matrix+group, grad.num_cols, grad.num_rows, q_bar);
+		case FEATURE_GROUP:
+			return lq_norm(grad.matrix+options.ind[group], options.ind[group+1]-options.ind[group],
+			               1, q_bar) / options.gWeight[group];
+		case PLAIN:
+			return Math::abs(grad.matrix[group]);
+		default:
+			error("Screening is not supported for tree and fused regularization");
+	}
+	return 0.0;
+}
+
+int slep_num_groups(int n_feats, const slep_options& options)
+{
+	switch (options.mode)
+	{
+		case MULTITASK_GROUP:
+		case PLAIN:
+			return n_feats;
+		case FEATURE_GROUP:
+			return options.n_feature_blocks;
+		default:
+			return 0;
+	}
+}
+
+int slep_strong_rule(const SGMatrix<double>& grad, double lambda, double lambda_prev,
+                     const slep_options& options, bool* active)
+{
+	int n_groups = slep_num_groups(grad.num_rows, options);
+	int n_active = 0;
+	for (int i=0; i<n_groups; i++)
+	{
+		active[i] = group_dual_norm(grad, i, options) >= 2*lambda - lambda_prev;
+		if (active[i])
+			n_active++;
+	}
+	return n_active;
+}
+
+int slep_kkt_check(const SGMatrix<double>& grad, double lambda,
+                   const slep_options& options, bool* active)
+{
+	int n_groups = slep_num_groups(grad.num_rows, options);
+	int n_violations = 0;
+	for (int i=0; i<n_groups; i++)
+	{
+		if (!active[i] && group_dual_norm(grad, i, options) > lambda)
+		{
+			active[i] = true;
+			n_violations++;
+		}
+	}
+	return n_violations;
+}
+
+SGVector<float64_t> slep_z_path(float64_t z, float64_t ratio, int n)
+{
+	require(n > 0, "Number of path values must be positive");
+	require(ratio > 0 && ratio <= 1, "Path ratio must be in (0,1]");
+
+	SGVector<float64_t> path(n);
+	for (int k=0; k<n; k++)
+		path[k] = n>1 ? z*Math::pow(ratio, double(k)/(n-1)) : z;
+	return path;
+}
+
+std::vector<slep_result_t> slep_solver_path(
+		const std::shared_ptr<DotFeatures>& features,
+		double* y,
+		const SGVector<float64_t>& z,
+		const slep_options& options)
+{
+	int n_feats = features->get_dim_feature_space();
+	int n_vecs = features->get_num_vectors();
+	int n_tasks = 0, n_blocks = 0;
+	problem_size(options, n_tasks, n_blocks);
+
+	// ATx is a part of the least squares gradient and lambda_max relates
+	// z to lambda if the regularization is relative
+	SGVector<double> ATx(n_feats*n_tasks);
+	ATx.zero();
+	double lambda_max = compute_lambda(ATx.vector, 1.0, features, y, n_vecs, n_feats, n_blocks, options);
+	double scale = options.regularization!=0 ? lambda_max : 1.0;
+
+	int n_groups = slep_num_groups(n_feats, options);
+	SGVector<bool> active(n_groups);
+
+	slep_options path_options = options;
+	std::vector<slep_result_t> path;
+	path.reserve(z.vlen);
+	for (int k=0; k<z.vlen; k++)
+	{
+		path_options.active = NULL;
+		if (k>0)
+		{
+			path_options.last_result = &path.back();
+			if (n_groups>0)
+			{
+				SGMatrix<double> grad = loss_gradient(features, ATx.vector, y, path.back(),
+				                                      n_vecs, n_feats, n_tasks, options);
+				int n_active = slep_strong_rule(grad, z[k]*scale, z[k-1]*scale, options, active.vector);
+				SG_DEBUG("z = {}: {} of {} groups pass the strong rule", z[k], n_active, n_groups)
+				path_options.active = active.vector;
+			}
+		}
+
+		slep_result_t result = slep_solver(features, y, z[k], path_options);
+
+		// the strong rule may discard groups that are active at the optimum,
+		// these are added back and the problem is solved again
+		while (path_options.active)
+		{
+			SGMatrix<double> grad = loss_gradient(features, ATx.vector, y, result,
+			                                      n_vecs, n_feats, n_tasks, options);
+			int n_violations = slep_kkt_check(grad, z[k]*scale, options, active.vector);
+			if (n_violations==0)
+				break;
+
+			SG_DEBUG("z = {}: {} groups violate the KKT conditions", z[k], n_violations)
+			path_options.last_result = &result;
+			result = slep_solver(features, y, z[k], path_options);
+		}
+		path.push_back(result);
+	}
+	return path;
+}
 };
 
 #endif //USE_GPL_SHOGUN
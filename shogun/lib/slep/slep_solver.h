@@ -18,6 +18,8 @@
 #include <shogun/lib/slep/slep_options.h>
 #include <shogun/features/DotFeatures.h>
 
+#include <vector>
+
 namespace shogun
 {
 
@@ -41,6 +43,61 @@ slep_result_t slep_solver(
 		double z,
 		const slep_options& options);
 
+/** Solves the problem for a sequence of regularization values,
+ * each solution is the initial point of the next one. Before each solve
+ * the groups discarded by the sequential strong rule are fixed to zero,
+ * the solution is checked against the KKT conditions of the full problem
+ * and solved again if some discarded group violates them. Screening is
+ * used in MULTITASK_GROUP, FEATURE_GROUP and PLAIN modes only.
+ *
+ * @param features features
+ * @param y labels
+ * @param z decreasing regularization values
+ * @param options options of solver
+ * @return solutions for the values of z
+ */
+std::vector<slep_result_t> slep_solver_path(
+		const std::shared_ptr<DotFeatures>& features,
+		double* y,
+		const SGVector<float64_t>& z,
+		const slep_options& options);
+
+/** Geometric sequence of n regularization values from z down to z*ratio
+ *
+ * @param z largest value
+ * @param ratio ratio of the smallest and the largest value
+ * @param n number of values
+ */
+SGVector<float64_t> slep_z_path(float64_t z, float64_t ratio, int n);
+
+/** Number of groups screened in the mode of the options, that is
+ * features for MULTITASK_GROUP and PLAIN, feature blocks for FEATURE_GROUP
+ * and zero for modes that do not support screening.
+ */
+int slep_num_groups(int n_feats, const slep_options& options);
+
+/** Sequential strong rule, marks a group active if the dual norm of its
+ * loss gradient at the solution for lambda_prev is at least
+ * 2*lambda - lambda_prev.
+ *
+ * @param grad loss gradient, a column per task
+ * @param lambda current regularization
+ * @param lambda_prev previous regularization
+ * @param options options of solver
+ * @param active array of slep_num_groups() flags to fill
+ * @return number of active groups
+ */
+int slep_strong_rule(const SGMatrix<double>& grad, double lambda, double lambda_prev,
+                     const slep_options& options, bool* active);
+
+/** Marks active the discarded groups that violate the KKT conditions,
+ * i.e. the dual norm of their loss gradient exceeds lambda.
+ *
+ * @return number of violating groups
+ */
+int slep_kkt_check(const SGMatrix<double>& grad, double lambda,
+                   const slep_options& options, bool* active);
+
 };
 #endif //USE_GPL_SHOGUN
 #endif   /* ----- #ifndef SLEP_LOGISTIC_H_  ----- */
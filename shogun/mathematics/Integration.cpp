@@ -26,7 +26,11 @@
 #include <shogun/mathematics/eigen3.h>
 #include <shogun/lib/SGVector.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 using namespace shogun;
 using namespace Eigen;
@@ -36,6 +40,76 @@ namespace shogun
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
+/** evaluate y[i]=f(x[i]) for n points, with a single call if f is a
+ * BatchFunction
+ */
+static void evaluate_function(const std::shared_ptr<Function>& f,
+	const float64_t* x, float64_t* y, index_t n)
+{
+	if (auto bf=std::dynamic_pointer_cast<BatchFunction>(f))
+	{
+		bf->evaluate(x, y, n);
+		return;
+	}
+
+	for (index_t i=0; i<n; i++)
+		y[i]=(*f)(x[i]);
+}
+
+/** Gauss-Hermite nodes and weights of one order */
+struct GaussHermiteTable
+{
+	/** nodes */
+	SGVector<float64_t> x;
+
+	/** weights */
+	SGVector<float64_t> w;
+};
+
+/** return the cached Gauss-Hermite table of order n, it is computed by
+ * the first caller. Tables are never modified or removed once cached,
+ * so the returned reference stays valid.
+ */
+static const GaussHermiteTable& gauher_table(index_t n)
+{
+	static std::mutex cache_mutex;
+	static std::map<index_t, std::unique_ptr<GaussHermiteTable>> cache;
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	std::unique_ptr<GaussHermiteTable>& table=cache[n];
+
+	if (!table)
+	{
+		table=std::make_unique<GaussHermiteTable>();
+		table->x=SGVector<float64_t>(n);
+		table->w=SGVector<float64_t>(n);
+
+		Map<VectorXd> eigen_x(table->x.vector, n);
+		Map<VectorXd> eigen_w(table->w.vector, n);
+
+		eigen_x.setZero();
+		eigen_w.setOnes();
+
+		if (n > 1)
+		{
+			//b = sqrt( (1:N-1)/2 )';
+			//[V,D] = eig( diag(b,1) + diag(b,-1) );
+			VectorXd diag=VectorXd::Zero(n);
+			VectorXd subdiag=(0.5*ArrayXd::LinSpaced(n-1,1,n-1)).sqrt();
+			SelfAdjointEigenSolver<MatrixXd> eig;
+			eig.computeFromTridiagonal(diag, subdiag, ComputeEigenvectors);
+
+			//w = V(1,:)'.^2
+			eigen_w=eig.eigenvectors().row(0).transpose().array().square();
+
+			//x = sqrt(2)*diag(D)
+			eigen_x=eig.eigenvalues()*sqrt(2.0);
+		}
+	}
+
+	return *table;
+}
+
 /** @brief Class of the function, which is used for standard infinite
  * to finite integral transformation
  *
@@ -46,7 +120,7 @@ namespace shogun
  * where \f$g(t)=\frac{t}{1-t^2}\f$ and
  * \f$g'(t)=\frac{1+t^2}{(1-t^2)^2}\f$.
  */
-class ITransformFunction : public Function
+class ITransformFunction : public BatchFunction
 {
 public:
 	/** constructor
@@ -76,6 +150,27 @@ public:
 		return (*m_f)(gx)*dgx;
 	}
 
+	/** evaluate the function at n points
+	 *
+	 * @param x arguments
+	 * @param y values are saved in this pre-allocated array
+	 * @param n number of points
+	 */
+	void evaluate(const float64_t* x, float64_t* y, index_t n) override
+	{
+		std::vector<float64_t> gx(n);
+		for (index_t i=0; i<n; i++)
+			gx[i]=x[i]/(1.0-Math::sq(x[i]));
+
+		evaluate_function(m_f, gx.data(), y, n);
+
+		for (index_t i=0; i<n; i++)
+		{
+			float64_t hx=1.0/(1.0-Math::sq(x[i]));
+			y[i]*=(1.0+Math::sq(x[i]))*Math::sq(hx);
+		}
+	}
+
 private:
 	/** function \f$f(x)\f$ */
 	std::shared_ptr<Function> m_f;
@@ -96,7 +191,7 @@ private:
  *
  * where \f$g(s)=\frac{s}{1+s}\f$ and \f$g'(s)=\frac{1}{(1+s)^2}\f$.
  */
-class ILTransformFunction : public Function
+class ILTransformFunction : public BatchFunction
 {
 public:
 	/** constructor
@@ -128,6 +223,27 @@ public:
 		return -(*m_f)(m_b-Math::sq(gx))*2*gx*dgx;
 	}
 
+	/** evaluate the function at n points
+	 *
+	 * @param x arguments
+	 * @param y values are saved in this pre-allocated array
+	 * @param n number of points
+	 */
+	void evaluate(const float64_t* x, float64_t* y, index_t n) override
+	{
+		std::vector<float64_t> t(n);
+		for (index_t i=0; i<n; i++)
+			t[i]=m_b-Math::sq(x[i]/(1.0+x[i]));
+
+		evaluate_function(m_f, t.data(), y, n);
+
+		for (index_t i=0; i<n; i++)
+		{
+			float64_t hx=1.0/(1.0+x[i]);
+			y[i]*=-2*x[i]*hx*Math::sq(hx);
+		}
+	}
+
 private:
 	/** function \f$f(x)\f$ */
 	std::shared_ptr<Function> m_f;
@@ -151,7 +267,7 @@ private:
  *
  * where \f$g(s)=\frac{s}{1-s}\f$ and \f$g'(s)=\frac{1}{(1-s)^2}\f$.
  */
-class IUTransformFunction : public Function
+class IUTransformFunction : public BatchFunction
 {
 public:
 	/** constructor
@@ -183,6 +299,27 @@ public:
 		return (*m_f)(m_a+Math::sq(gx))*2*gx*dgx;
 	}
 
+	/** evaluate the function at n points
+	 *
+	 * @param x arguments
+	 * @param y values are saved in this pre-allocated array
+	 * @param n number of points
+	 */
+	void evaluate(const float64_t* x, float64_t* y, index_t n) override
+	{
+		std::vector<float64_t> t(n);
+		for (index_t i=0; i<n; i++)
+			t[i]=m_a+Math::sq(x[i]/(1.0-x[i]));
+
+		evaluate_function(m_f, t.data(), y, n);
+
+		for (index_t i=0; i<n; i++)
+		{
+			float64_t hx=1.0/(1.0-x[i]);
+			y[i]*=2*x[i]*hx*Math::sq(hx);
+		}
+	}
+
 private:
 	/** function \f$f(x)\f$ */
 	std::shared_ptr<Function> m_f;
@@ -201,7 +338,7 @@ private:
  * where \f$g(t)=\frac{b-a}{2}(\frac{t}{2}(3-t^2))+\frac{b+a}{2}\f$
  * and \f$g'(t)=\frac{b-a}{4}(3-3t^2)\f$.
  */
-class TransformFunction : public Function
+class TransformFunction : public BatchFunction
 {
 public:
 	/** constructor
@@ -236,6 +373,25 @@ public:
 		return (*m_f)(gx)*dgx;
 	}
 
+	/** evaluate the function at n points
+	 *
+	 * @param x arguments
+	 * @param y values are saved in this pre-allocated array
+	 * @param n number of points
+	 */
+	void evaluate(const float64_t* x, float64_t* y, index_t n) override
+	{
+		float64_t qw=(m_b-m_a)/4.0;
+		std::vector<float64_t> gx(n);
+		for (index_t i=0; i<n; i++)
+			gx[i]=qw*(x[i]*(3.0-Math::sq(x[i])))+(m_b+m_a)/2.0;
+
+		evaluate_function(m_f, gx.data(), y, n);
+
+		for (index_t i=0; i<n; i++)
+			y[i]*=qw*3.0*(1.0-Math::sq(x[i]));
+	}
+
 private:
 	/** function \f$f(x)\f$ */
 	std::shared_ptr<Function> m_f;
@@ -463,12 +619,9 @@ void Integration::evaluate_quadgk(const std::shared_ptr<Function>& f, DynamicArr
 	MatrixXd x=eigen_hw*eigen_xgk.adjoint()+eigen_center*
 		(VectorXd::Ones(n)).adjoint();
 
-	// compute ygk=f(x)
+	// compute ygk=f(x) for all nodes of all subintervals at once
 	MatrixXd ygk(x.rows(), x.cols());
-
-	for (index_t i=0; i<ygk.rows(); i++)
-		for (index_t j=0; j<ygk.cols(); j++)
-			ygk(i,j)=(*f)(x(i,j));
+	evaluate_function(f, x.data(), ygk.data(), x.size());
 
 	// compute value of definite integral on each subinterval
 	VectorXd eigen_q=((ygk*eigen_wgk.asDiagonal()).rowwise().sum()).cwiseProduct(
@@ -501,29 +654,18 @@ void Integration::generate_gauher(SGVector<float64_t> xgh, SGVector<float64_t> w
 	}
 	else
 	{
-		Map<VectorXd> eigen_xgh(xgh.vector, xgh.vlen);
-		Map<VectorXd> eigen_wgh(wgh.vector, wgh.vlen);
-
-		eigen_xgh = MatrixXd::Zero(n,1);
-		eigen_wgh = MatrixXd::Ones(n,1);
-
-		if (n > 1)
-		{
-			MatrixXd v = MatrixXd::Zero(n,n);
-
-			//b = sqrt( (1:N-1)/2 )';
-			//[V,D] = eig( diag(b,1) + diag(b,-1) );
-			v.block(0, 1, n-1, n-1).diagonal() = (0.5*ArrayXd::LinSpaced(n-1,1,n-1)).sqrt();
-			v.block(1, 0, n-1, n-1).diagonal() = v.block(0, 1, n-1, n-1).diagonal();
-			EigenSolver<MatrixXd> eig(v);
+		const GaussHermiteTable& table=gauher_table(n);
+		sg_memcpy(xgh.vector, table.x.vector, sizeof(float64_t)*n);
+		sg_memcpy(wgh.vector, table.w.vector, sizeof(float64_t)*n);
+	}
+}
 
-			//w = V(1,:)'.^2
-			eigen_wgh = eig.eigenvectors().row(0).transpose().real().array().pow(2);
+float64_t Integration::integrate_quadgh(std::shared_ptr<Function> f, index_t n)
+{
+	require(n>0, "Order of Gauss-Hermite rule must be positive, but is {}", n);
 
-			//x = sqrt(2)*diag(D)
-			eigen_xgh = eig.eigenvalues().real()*sqrt(2.0);
-		}
-	}
+	const GaussHermiteTable& table=gauher_table(n);
+	return evaluate_quadgh(f, n, table.x.vector, table.w.vector);
 }
 
 void Integration::generate_gauher20(SGVector<float64_t> xgh, SGVector<float64_t> wgh)
@@ -735,10 +877,13 @@ float64_t Integration::evaluate_quadgh(const std::shared_ptr<Function>& f, index
 	require(xgh, "Gauss-Hermite nodes should not be NULL");
 	require(wgh, "Gauss-Hermite weights should not be NULL");
 
+	SGVector<float64_t> y(n);
+	evaluate_function(f, xgh, y.vector, n);
+
 	float64_t q=0.0;
 
 	for (index_t i=0; i<n; i++)
-		q+=wgh[i]*(*f)(xgh[i]);
+		q+=wgh[i]*y[i];
 
 	return q;
 }
@@ -36,6 +36,38 @@ namespace shogun
 {
 template<class T> class SGVector;
 
+/** @brief Function of one variable which can be evaluated at many
+ * points in one call
+ *
+ * The integration methods evaluate the integrand at whole arrays of
+ * nodes. Integrands derived from this class get all nodes of a
+ * quadrature rule at once, which saves a virtual call per node and
+ * allows vectorized implementations.
+ */
+class BatchFunction : public Function
+{
+public:
+	~BatchFunction() override { }
+
+	/** evaluate the function at n points
+	 *
+	 * The default implementation calls operator() for every point.
+	 *
+	 * @param x arguments
+	 * @param y values f(x[i]) are saved in this pre-allocated array, it
+	 * does not overlap with x
+	 * @param n number of points
+	 */
+	virtual void evaluate(const float64_t* x, float64_t* y, index_t n)
+	{
+		for (index_t i=0; i<n; i++)
+			y[i]=(*this)(x[i]);
+	}
+
+	/** @return object name */
+	const char* get_name() const override { return "BatchFunction"; }
+};
+
 /** @brief Class that contains certain methods related to numerical
  * integration
  */
@@ -125,11 +157,33 @@ public:
 		SGVector<float64_t> xgh, SGVector<float64_t> wgh);
 
 
+	/** numerically evaluate integral of the following kind
+	 *
+	 * \f[
+	 * \int_{-\infty}^{\infty}\frac{1}{\sqrt{2\pi}}e^{-x^2/2}f(x)dx
+	 * \f]
+	 *
+	 * using the n-point Gauss-Hermite rule of generate_gauher. The
+	 * nodes and weights of each order are computed once and cached.
+	 *
+	 * @param f integrable function of one variable
+	 * @param n order of the Gauss-Hermite rule
+	 *
+	 * @return approximate value of the integral
+	 */
+	static float64_t integrate_quadgh(std::shared_ptr<Function> f, index_t n);
+
 	/** generate Gauss-Hermite nodes
 	 *
 	 * Adapted form Gaussian Process Machine Learning Toolbox
 	 * (file util/gauher.m)
 	 *
+	 * The nodes and weights are the eigenvalues and the squared first
+	 * components of the eigenvectors of the symmetric tridiagonal Jacobi
+	 * matrix (Golub-Welsch). They are computed once per order and kept
+	 * in a cache shared by all threads, the nodes are in increasing
+	 * order.
+	 *
 	 * @param xgh nodes are saved in this pre-allocated array
 	 * @param wgh weights are saved in this pre-allocated array
 	 *
@@ -5,11 +5,138 @@
 
 #include <shogun/multiclass/CoverTreeKNNSolver.h>
 #include <shogun/lib/JLCoverTree.h>
+#include <shogun/lib/Time.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 using namespace shogun;
 
+namespace shogun
+{
+/** Cover tree of the training vectors, kept between queries */
+struct CoverTreeCache
+{
+	~CoverTreeCache()
+	{
+		free_children(top);
+	}
+
+	/** distance the tree was built with */
+	std::shared_ptr<Distance> distance;
+
+	/** training vectors (lhs of distance) the tree was built from */
+	std::shared_ptr<Features> features;
+
+	/** number of training vectors */
+	int32_t num_vectors;
+
+	/** root of the tree */
+	node<JLCoverTreePoint> top;
+};
+}
+
+/** Builds the tree of the lhs features of knn_distance */
+static std::shared_ptr<CoverTreeCache> training_tree(
+	const std::shared_ptr<Distance>& knn_distance)
+{
+	auto lhs = knn_distance->get_lhs();
+	SG_DEBUG("Building the cover tree of {} training vectors", lhs->get_num_vectors())
+
+	// From the lhs features stored in distance, build an array of cover
+	// tree points. The tree is built with lhs == rhs.
+	v_array< JLCoverTreePoint > set_of_points =
+		parse_points(knn_distance, FC_LHS);
+
+	auto tree = std::make_shared<CoverTreeCache>();
+	tree->distance = knn_distance;
+	tree->features = lhs;
+	tree->num_vectors = lhs->get_num_vectors();
+
+	auto r = knn_distance->replace_rhs(lhs);
+	tree->top = batch_create(set_of_points);
+	knn_distance->replace_rhs(r);
+
+	free(set_of_points.elements);
+
+	return tree;
+}
+
+/** Returns the cached tree if it was built for knn_distance and its
+ * current lhs features, the tree of the lhs features built for this query
+ * otherwise */
+static std::shared_ptr<CoverTreeCache> training_tree(
+	const std::shared_ptr<CoverTreeCache>& cache,
+	const std::shared_ptr<Distance>& knn_distance)
+{
+	auto lhs = knn_distance->get_lhs();
+	if (cache && cache->distance == knn_distance && cache->features == lhs &&
+		cache->num_vectors == lhs->get_num_vectors())
+		return cache;
+
+	return training_tree(knn_distance);
+}
+
+/** Builds the tree of the rhs features of knn_distance */
+static node<JLCoverTreePoint> query_tree(
+	const std::shared_ptr<Distance>& knn_distance)
+{
+	v_array< JLCoverTreePoint > set_of_queries =
+		parse_points(knn_distance, FC_RHS);
+
+	auto l = knn_distance->replace_lhs(knn_distance->get_rhs());
+	node<JLCoverTreePoint> top_query = batch_create(set_of_queries);
+	knn_distance->replace_lhs(l);
+
+	free(set_of_queries.elements);
+
+	return top_query;
+}
+
+/** Estimates the recall of approximate results on num_samples evenly
+ * spaced test vectors, a neighbor counts as correct if it is not further
+ * away than the exact k-th nearest neighbor */
+static float64_t estimate_recall(const std::shared_ptr<Distance>& knn_distance,
+	v_array< v_array< JLCoverTreePoint > >& res, int32_t k, int32_t num_samples)
+{
+	int32_t num_train = knn_distance->get_num_vec_lhs();
+	num_samples = Math::min(num_samples, (int32_t) res.index);
+	if (num_samples == 0 || k > num_train)
+		return 1;
+
+	std::vector<float64_t> dists(num_train);
+	int64_t num_found = 0;
+
+	for ( int32_t s = 0 ; s < num_samples ; ++s )
+	{
+		v_array< JLCoverTreePoint >& r = res[int64_t(s)*res.index/num_samples];
+		int32_t query = r[0].m_index;
+
+		for ( int32_t j = 0 ; j < num_train ; ++j )
+			dists[j] = knn_distance->distance(j, query);
+		std::nth_element(dists.begin(), dists.begin()+k-1, dists.end());
+		float64_t kth = dists[k-1];
+
+		for ( int32_t j = 1 ; j <= k && j < r.index ; ++j )
+			if (knn_distance->distance(r[j].m_index, query) <= kth)
+				num_found++;
+	}
+
+	return float64_t(num_found)/(int64_t(num_samples)*k);
+}
+
+/** Releases the results of a query */
+static void free_results(v_array< v_array< JLCoverTreePoint > >& res)
+{
+	for ( int32_t i = 0 ; i < res.index ; ++i )
+		free(res[i].elements);
+	free(res.elements);
+}
+
 CoverTreeKNNSolver::CoverTreeKNNSolver(const int32_t k, const float64_t q, const int32_t num_classes, const int32_t min_label, const SGVector<int32_t>& train_labels):
-KNNSolver(k, q, num_classes, min_label, train_labels) { /* nothing to do */ }
+KNNSolver(k, q, num_classes, min_label, train_labels), m_num_threads(1),
+m_epsilon(0), m_recall_samples(0), m_recall(1), m_queries_per_second(0) { /* nothing to do */ }
 
 std::shared_ptr<MulticlassLabels> CoverTreeKNNSolver::classify_objects(std::shared_ptr<Distance> knn_distance, const int32_t num_lab, SGVector<int32_t>& train_lab, SGVector<float64_t>& classes) const
 {
@@ -20,25 +147,24 @@ std::shared_ptr<MulticlassLabels> CoverTreeKNNSolver::classify_objects(std::shar
 	if ( m_q != 1.0 )
 		io::info("q != 1.0 not supported with cover tree, using q = 1");
 
-	// From the sets of features (lhs and rhs) stored in distance,
-	// build arrays of cover tree points
-	v_array< JLCoverTreePoint > set_of_points  =
-		parse_points(knn_distance, FC_LHS);
-	v_array< JLCoverTreePoint > set_of_queries =
-		parse_points(knn_distance, FC_RHS);
+	Time ttime;
+	float64_t tstart = ttime.cur_time_diff(false);
 
-	// Build the cover trees, one for the test vectors (rhs features)
-	// and another for the training vectors (lhs features)
-	auto r = knn_distance->replace_rhs( knn_distance->get_lhs() );
-	node<JLCoverTreePoint> top = batch_create(set_of_points);
-	auto l = knn_distance->replace_lhs(r);
-	knn_distance->replace_rhs(r);
-	node<JLCoverTreePoint> top_query = batch_create(set_of_queries);
+	// The cover tree of the training vectors (lhs features) is the one
+	// of build_tree() if it matches, the one of the test vectors (rhs
+	// features) is built for every query
+	auto tree = training_tree(m_tree, knn_distance);
+	const node<JLCoverTreePoint>& top = tree->top;
+	node<JLCoverTreePoint> top_query = query_tree(knn_distance);
 
-	// Get the k nearest neighbors to all the test vectors (batch method)
-	knn_distance->replace_lhs(l);
+	// Get the (approximate) k nearest neighbors to all the test vectors
+	// (batch method)
 	v_array< v_array< JLCoverTreePoint > > res;
-	k_nearest_neighbor(top, top_query, res, m_k);
+	approx_k_nearest_neighbor(top, top_query, res, m_k, m_epsilon, m_num_threads);
+
+	float64_t time = ttime.cur_time_diff(false) - tstart;
+	record_stats(res.index, time, estimate_recall(knn_distance, res, m_k,
+		m_epsilon > 0 ? m_recall_samples : 0));
 
 if (env()->io()->get_loglevel()<= io::MSG_DEBUG)
 {
@@ -66,10 +192,33 @@ if (env()->io()->get_loglevel()<= io::MSG_DEBUG)
 		output->set_label(res[i][0].m_index, out_idx+m_min_label);
 	}
 
+	free_results(res);
+	free_children(top_query);
 
 	return output;
 }
 
+void CoverTreeKNNSolver::record_stats(int32_t num_queries, float64_t time,
+	float64_t recall) const
+{
+	m_queries_per_second = time > 0 ? num_queries/time : 0;
+	m_recall = recall;
+
+	SG_DEBUG("{} cover tree queries in {:.3f}s ({:.1f}/s), eps={}, recall={:.4f}",
+		num_queries, time, m_queries_per_second, m_epsilon, m_recall)
+}
+
+void CoverTreeKNNSolver::build_tree(const std::shared_ptr<Distance>& knn_distance)
+{
+	require(knn_distance && knn_distance->get_lhs(), "Distance with training features required");
+	m_tree = training_tree(knn_distance);
+}
+
+void CoverTreeKNNSolver::reset_tree()
+{
+	m_tree.reset();
+}
+
 SGVector<int32_t> CoverTreeKNNSolver::classify_objects_k(std::shared_ptr<Distance> knn_distance, int32_t num_lab, SGVector<int32_t>& train_lab,  SGVector<int32_t>& classes) const
 {
 	SGVector<int32_t> output(m_k*num_lab);
@@ -77,25 +226,24 @@ SGVector<int32_t> CoverTreeKNNSolver::classify_objects_k(std::shared_ptr<Distanc
 	//allocation for distances to nearest neighbors
 	SGVector<float64_t> dists(m_k);
 
-	// From the sets of features (lhs and rhs) stored in distance,
-	// build arrays of cover tree points
-	v_array< JLCoverTreePoint > set_of_points  =
-		parse_points(knn_distance, FC_LHS);
-	v_array< JLCoverTreePoint > set_of_queries =
-		parse_points(knn_distance, FC_RHS);
+	Time ttime;
+	float64_t tstart = ttime.cur_time_diff(false);
 
-	// Build the cover trees, one for the test vectors (rhs features)
-	// and another for the training vectors (lhs features)
-	auto r = knn_distance->replace_rhs( knn_distance->get_lhs() );
-	node< JLCoverTreePoint > top = batch_create(set_of_points);
-	auto l = knn_distance->replace_lhs(r);
-	knn_distance->replace_rhs(r);
-	node< JLCoverTreePoint > top_query = batch_create(set_of_queries);
+	// The cover tree of the training vectors (lhs features) is the one
+	// of build_tree() if it matches, the one of the test vectors (rhs
+	// features) is built for every query
+	auto tree = training_tree(m_tree, knn_distance);
+	const node<JLCoverTreePoint>& top = tree->top;
+	node<JLCoverTreePoint> top_query = query_tree(knn_distance);
 
-	// Get the k nearest neighbors to all the test vectors (batch method)
-	knn_distance->replace_lhs(l);
+	// Get the (approximate) k nearest neighbors to all the test vectors
+	// (batch method)
 	v_array< v_array< JLCoverTreePoint > > res;
-	k_nearest_neighbor(top, top_query, res, m_k);
+	approx_k_nearest_neighbor(top, top_query, res, m_k, m_epsilon, m_num_threads);
+
+	float64_t time = ttime.cur_time_diff(false) - tstart;
+	record_stats(res.index, time, estimate_recall(knn_distance, res, m_k,
+		m_epsilon > 0 ? m_recall_samples : 0));
 
 	for ( index_t i = 0 ; i < res.index ; ++i )
 	{
@@ -118,5 +266,8 @@ SGVector<int32_t> CoverTreeKNNSolver::classify_objects_k(std::shared_ptr<Distanc
 				train_lab.vector, num_lab);
 	}
 
+	free_results(res);
+	free_children(top_query);
+
 	return output;
 }
@@ -13,19 +13,32 @@
 #include <shogun/distance/Distance.h>
 #include <shogun/multiclass/KNNSolver.h>
 
+#include <memory>
+
 namespace shogun
 {
 
+struct CoverTreeCache;
+
 /**
  * Cover tree solver. It uses cover trees to speed up the nearest neighbour computation.
  * For more information, see https://en.wikipedia.org/wiki/Cover_tree
  *
+ * KNN creates a new solver for every apply, so the settings below and the
+ * tree of build_tree() only take effect when a solver is used directly
+ * and kept across queries.
+ *
+ * A solver and its distance must not be used from several threads at
+ * once: queries temporarily replace the lhs or rhs of the distance to
+ * build the cover trees, and store their recall and speed in the solver.
+ * The search of a single query is parallel, see set_num_threads().
  */
 class CoverTreeKNNSolver : public KNNSolver
 {
 	public:
 		/** default constructor */
-		CoverTreeKNNSolver() : KNNSolver()
+		CoverTreeKNNSolver() : KNNSolver(), m_num_threads(1), m_epsilon(0),
+			m_recall_samples(0), m_recall(1), m_queries_per_second(0)
 		{ /* nothing to do */ }
 
 		/** deconstructor */
@@ -45,9 +58,132 @@ class CoverTreeKNNSolver : public KNNSolver
 
 		SGVector<int32_t> classify_objects_k(std::shared_ptr<Distance> d, const int32_t num_lab, SGVector<int32_t>& train_lab, SGVector<int32_t>& classes) const override;
 
+		/** set number of threads
+		 *
+		 * The tree of the test vectors is split into subtrees which are
+		 * searched in parallel. The distance must be safe to evaluate from
+		 * several threads then.
+		 *
+		 * @param num_threads number of threads
+		 */
+		void set_num_threads(int32_t num_threads)
+		{
+			require(num_threads > 0, "Number of threads must be positive!");
+			m_num_threads=num_threads;
+		}
+
+		/** get number of threads
+		 *
+		 * @return number of threads
+		 */
+		int32_t get_num_threads() const { return m_num_threads; }
+
+		/** set approximation of the neighbor search
+		 *
+		 * With eps > 0 the search is (1+eps)-approximate: subtrees of the
+		 * training tree whose points cannot be closer than the current
+		 * k-th neighbor divided by 1+eps are not searched, which prunes
+		 * much more aggressively. eps = 0 is the exact search.
+		 *
+		 * @param eps approximation, non-negative
+		 */
+		void set_epsilon(float64_t eps)
+		{
+			require(eps >= 0, "Approximation epsilon must not be negative!");
+			m_epsilon=eps;
+		}
+
+		/** get approximation of the neighbor search
+		 *
+		 * @return approximation epsilon
+		 */
+		float64_t get_epsilon() const { return m_epsilon; }
+
+		/** set number of test vectors used to estimate the recall
+		 *
+		 * After an approximate search the exact neighbors of this many
+		 * evenly spaced test vectors are computed by brute force and
+		 * compared to the approximate ones, see get_recall().
+		 *
+		 * @param num_samples number of test vectors, 0 disables it
+		 */
+		void set_recall_samples(int32_t num_samples)
+		{
+			require(num_samples >= 0, "Number of samples must not be negative!");
+			m_recall_samples=num_samples;
+		}
+
+		/** get number of test vectors used to estimate the recall
+		 *
+		 * @return number of test vectors
+		 */
+		int32_t get_recall_samples() const { return m_recall_samples; }
+
+		/** get recall of the last search
+		 *
+		 * The fraction of returned neighbors that are among the exact k
+		 * nearest ones, estimated on the recall samples. 1 for exact
+		 * searches or if the estimate is disabled.
+		 *
+		 * @return recall
+		 */
+		float64_t get_recall() const { return m_recall; }
+
+		/** get throughput of the last search
+		 *
+		 * Test vectors per second including the construction of their
+		 * cover tree (and of the training tree if none was built).
+		 *
+		 * @return test vectors per second
+		 */
+		float64_t get_queries_per_second() const { return m_queries_per_second; }
+
+		/** build the cover tree of the training vectors (lhs of the
+		 * distance) and keep it for the following queries
+		 *
+		 * Queries use the kept tree as long as they get the same distance
+		 * with the same lhs features, otherwise they build a tree of their
+		 * own. The tree refers to the coordinates of the training vectors,
+		 * so it has to be built again or dropped with reset_tree() when
+		 * they are modified in place.
+		 *
+		 * @param knn_distance distance with the training vectors as lhs
+		 */
+		void build_tree(const std::shared_ptr<Distance>& knn_distance);
+
+		/** drop the kept cover tree of the training vectors */
+		void reset_tree();
+
 		/** @return object name */
 		const char* get_name() const override { return "CoverTreeKNNSolver"; }
 
+	private:
+		/** keep the statistics of a search
+		 *
+		 * @param num_queries number of test vectors
+		 * @param time duration of the search in seconds
+		 * @param recall estimated recall
+		 */
+		void record_stats(int32_t num_queries, float64_t time, float64_t recall) const;
+
+	private:
+		/** number of threads for the queries */
+		int32_t m_num_threads;
+
+		/** approximation of the neighbor search */
+		float64_t m_epsilon;
+
+		/** number of test vectors used to estimate the recall */
+		int32_t m_recall_samples;
+
+		/** recall of the last search */
+		mutable float64_t m_recall;
+
+		/** test vectors per second of the last search */
+		mutable float64_t m_queries_per_second;
+
+		/** cover tree of the training vectors */
+		std::shared_ptr<CoverTreeCache> m_tree;
 };
 }
 
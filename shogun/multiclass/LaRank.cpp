@@ -50,7 +50,9 @@
 #include <shogun/lib/config.h>
 
 #include <algorithm>
+#include <cmath>
 #include <ctime>
+#include <limits>
 #include <utility>
 #include <vector>
 #ifndef _MSC_VER
@@ -72,67 +74,73 @@ using namespace shogun;
 
 namespace shogun
 {
-	static larank_kcache_t* larank_kcache_create (std::shared_ptr<Kernel> kernelfunc)
+	/* Kernel rows are shared by all the outputs. Row i holds K(i,j) at
+	 * position j for every example j. Entries not computed yet are NaN, so
+	 * every kernel value is computed at most once while its row is cached,
+	 * whichever output asks for it. */
+	static larank_krows_t* larank_krows_create (std::shared_ptr<Kernel> kernelfunc, int32_t n)
 	{
-		larank_kcache_t *self;
-		self = SG_CALLOC (larank_kcache_t, 1);
-		self->l = 0;
-		self->maxrowlen = 0;
+		larank_krows_t *self;
+		self = SG_CALLOC (larank_krows_t, 1);
+		self->n = n;
 		self->func = std::move(kernelfunc);
-		self->prevbuddy = self;
-		self->nextbuddy = self;
-		self->cursize = sizeof (larank_kcache_t);
+		self->cursize = sizeof (larank_krows_t);
 		self->maxsize = 256 * 1024 * 1024;
-		self->qprev = SG_MALLOC(int32_t, 1);
-		self->qnext = SG_MALLOC(int32_t, 1);
+		self->nthreads = 1;
+		self->rdata = SG_CALLOC (float32_t*, n);
+		self->qprev = SG_MALLOC(int32_t, 1 + n);
+		self->qnext = SG_MALLOC(int32_t, 1 + n);
 		self->rnext = self->qnext + 1;
 		self->rprev = self->qprev + 1;
 		self->rprev[-1] = -1;
 		self->rnext[-1] = -1;
+		for (int32_t i = 0; i < n; i++)
+		{
+			self->rnext[i] = i;
+			self->rprev[i] = i;
+		}
 		return self;
 	}
 
-	static void xtruncate (larank_kcache_t * self, int32_t k, int32_t nlen)
+	static void xunlink (larank_krows_t * self, int32_t k)
 	{
-		int32_t olen = self->rsize[k];
-		if (nlen < olen)
-		{
-			float32_t *ndata;
-			float32_t *odata = self->rdata[k];
-			if (nlen > 0)
-			{
-				ndata = SG_MALLOC(float32_t, nlen);
-				sg_memcpy (ndata, odata, nlen * sizeof (float32_t));
-			}
-			else
-			{
-				ndata = 0;
-				self->rnext[self->rprev[k]] = self->rnext[k];
-				self->rprev[self->rnext[k]] = self->rprev[k];
-				self->rnext[k] = self->rprev[k] = k;
-			}
-			SG_FREE (odata);
-			self->rdata[k] = ndata;
-			self->rsize[k] = nlen;
-			self->cursize += (int64_t) (nlen - olen) * sizeof (float32_t);
-		}
+		self->rnext[self->rprev[k]] = self->rnext[k];
+		self->rprev[self->rnext[k]] = self->rprev[k];
+		self->rnext[k] = self->rprev[k] = k;
 	}
 
-	static void xpurge (larank_kcache_t * self)
+	static void xlink (larank_krows_t * self, int32_t k)
+	{
+		self->rprev[k] = -1;
+		self->rnext[k] = self->rnext[-1];
+		self->rnext[self->rprev[k]] = k;
+		self->rprev[self->rnext[k]] = k;
+	}
+
+	static void xdrop (larank_krows_t * self, int32_t k)
+	{
+		SG_FREE (self->rdata[k]);
+		self->rdata[k] = 0;
+		self->cursize -= (int64_t) self->n * sizeof (float32_t);
+		xunlink (self, k);
+	}
+
+	static void xpurge (larank_krows_t * self)
 	{
 		if (self->cursize > self->maxsize)
 		{
+			/* drop the least recently used rows, but never the last one */
 			int32_t k = self->rprev[-1];
 			while (self->cursize > self->maxsize && k != self->rnext[-1])
 			{
 				int32_t pk = self->rprev[k];
-				xtruncate (self, k, 0);
+				xdrop (self, k);
 				k = pk;
 			}
 		}
 	}
 
-	static void larank_kcache_set_maximum_size (larank_kcache_t * self, int64_t entries)
+	static void larank_krows_set_maximum_size (larank_krows_t * self, int64_t entries)
 	{
 		ASSERT (self)
 		ASSERT (entries > 0)
@@ -140,151 +148,134 @@ namespace shogun
 		xpurge (self);
 	}
 
-	static void larank_kcache_destroy (larank_kcache_t * self)
+	static void larank_krows_destroy (larank_krows_t * self)
 	{
 		if (self)
 		{
-			int32_t i;
-			larank_kcache_t *nb = self->nextbuddy;
-			larank_kcache_t *pb = self->prevbuddy;
-			pb->nextbuddy = nb;
-			nb->prevbuddy = pb;
-			/* delete */
-			if (self->i2r)
-				SG_FREE (self->i2r);
-			if (self->r2i)
-				SG_FREE (self->r2i);
 			if (self->rdata)
-				for (i = 0; i < self->l; i++)
+			{
+				for (int32_t i = 0; i < self->n; i++)
 					if (self->rdata[i])
 						SG_FREE (self->rdata[i]);
-			if (self->rdata)
 				SG_FREE (self->rdata);
-			if (self->rsize)
-				SG_FREE (self->rsize);
-			if (self->rdiag)
-				SG_FREE (self->rdiag);
+			}
 			if (self->qnext)
 				SG_FREE (self->qnext);
 			if (self->qprev)
 				SG_FREE (self->qprev);
-			memset (self, 0, sizeof (larank_kcache_t));
+			self->func = NULL;
 			SG_FREE (self);
 		}
 	}
 
-	static void xminsize (larank_kcache_t * self, int32_t n)
+	static float64_t xquery (larank_krows_t * self, int32_t i, int32_t j)
+	{
+		float32_t *di = self->rdata[i];
+		float32_t *dj = self->rdata[j];
+		if (di && !std::isnan (di[j]))
+			return di[j];
+		if (dj && !std::isnan (dj[i]))
+			return dj[i];
+		/* compute */
+		float32_t k = self->func->kernel(i, j);
+		if (di)
+			di[j] = k;
+		if (dj)
+			dj[i] = k;
+		return k;
+	}
+
+	static float64_t larank_krows_query (larank_krows_t * self, int32_t i, int32_t j)
+	{
+		ASSERT (self)
+		ASSERT (i >= 0 && i < self->n)
+		ASSERT (j >= 0 && j < self->n)
+		return xquery (self, i, j);
+	}
+
+	/* Row i with at least the entries cols[0..len) computed. The missing
+	 * entries are taken from the transposed rows if cached, the rest is
+	 * evaluated in parallel. */
+	static const float32_t* larank_krows_query_row (larank_krows_t * self, int32_t i, const int32_t* cols, int32_t len)
 	{
-		int32_t ol = self->l;
-		if (n > ol)
+		ASSERT (i >= 0 && i < self->n)
+		float32_t *d = self->rdata[i];
+		if (d)
+			xunlink (self, i);
+		else
 		{
-			int32_t i;
-			int32_t nl = Math::max (256, ol);
-			while (nl < n)
-				nl = nl + nl;
-			self->i2r = SG_REALLOC (int32_t, self->i2r, self->l, nl);
-			self->r2i = SG_REALLOC (int32_t, self->r2i, self->l, nl);
-			self->rsize = SG_REALLOC (int32_t, self->rsize, self->l, nl);
-			self->qnext = SG_REALLOC (int32_t, self->qnext, 1+self->l, (1 + nl));
-			self->qprev = SG_REALLOC (int32_t, self->qprev, 1+self->l, (1 + nl));
-			self->rdiag = SG_REALLOC (float32_t, self->rdiag, self->l, nl);
-			self->rdata = SG_REALLOC (float32_t*, self->rdata, self->l, nl);
-			self->rnext = self->qnext + 1;
-			self->rprev = self->qprev + 1;
-			for (i = ol; i < nl; i++)
-			{
-				self->i2r[i] = i;
-				self->r2i[i] = i;
-				self->rsize[i] = -1;
-				self->rnext[i] = i;
-				self->rprev[i] = i;
-				self->rdata[i] = 0;
-			}
-			self->l = nl;
+			d = SG_MALLOC(float32_t, self->n);
+			std::fill (d, d + self->n, std::numeric_limits<float32_t>::quiet_NaN());
+			self->rdata[i] = d;
+			self->cursize += (int64_t) self->n * sizeof (float32_t);
 		}
+		xlink (self, i);
+
+		std::vector<int32_t> missing;
+		for (int32_t p = 0; p < len; p++)
+		{
+			int32_t j = cols[p];
+			if (!std::isnan (d[j]))
+				continue;
+			if (self->rdata[j] && !std::isnan (self->rdata[j][i]))
+				d[j] = self->rdata[j][i];
+			else
+				missing.push_back (j);
+		}
+
+		int32_t nmissing = missing.size ();
+		#pragma omp parallel for num_threads(self->nthreads) if (self->nthreads > 1 && nmissing > 256)
+		for (int32_t p = 0; p < nmissing; p++)
+			d[missing[p]] = self->func->kernel(i, missing[p]);
+
+		xpurge (self);
+		return d;
 	}
 
-	static int32_t* larank_kcache_r2i (larank_kcache_t * self, int32_t n)
+	/* Per output view of the shared rows: the support vectors of the
+	 * output are the examples r2i[0..l), i2r is the inverse permutation. */
+	static larank_kcache_t* larank_kcache_create (larank_krows_t * rows)
 	{
-		xminsize (self, n);
-		return self->r2i;
+		larank_kcache_t *self;
+		self = SG_CALLOC (larank_kcache_t, 1);
+		self->rows = rows;
+		self->l = rows->n;
+		self->i2r = SG_MALLOC(int32_t, self->l);
+		self->r2i = SG_MALLOC(int32_t, self->l);
+		for (int32_t i = 0; i < self->l; i++)
+		{
+			self->i2r[i] = i;
+			self->r2i[i] = i;
+		}
+		return self;
 	}
 
-	static void xextend (larank_kcache_t * self, int32_t k, int32_t nlen)
+	static void larank_kcache_destroy (larank_kcache_t * self)
 	{
-		int32_t olen = self->rsize[k];
-		if (nlen > olen)
+		if (self)
 		{
-			float32_t *ndata = SG_MALLOC(float32_t, nlen);
-			if (olen > 0)
-			{
-				float32_t *odata = self->rdata[k];
-				sg_memcpy (ndata, odata, olen * sizeof (float32_t));
-				SG_FREE (odata);
-			}
-			self->rdata[k] = ndata;
-			self->rsize[k] = nlen;
-			self->cursize += (int64_t) (nlen - olen) * sizeof (float32_t);
-			self->maxrowlen = Math::max (self->maxrowlen, nlen);
+			if (self->i2r)
+				SG_FREE (self->i2r);
+			if (self->r2i)
+				SG_FREE (self->r2i);
+			memset (self, 0, sizeof (larank_kcache_t));
+			SG_FREE (self);
 		}
 	}
 
+	static int32_t* larank_kcache_r2i (larank_kcache_t * self)
+	{
+		return self->r2i;
+	}
+
+	static int32_t larank_kcache_rank (larank_kcache_t * self, int32_t i)
+	{
+		ASSERT (i >= 0 && i < self->l)
+		return self->i2r[i];
+	}
+
 	static void xswap (larank_kcache_t * self, int32_t i1, int32_t i2, int32_t r1, int32_t r2)
 	{
-		/* swap row data */
-		if (r1 < self->maxrowlen || r2 < self->maxrowlen)
-		{
-			int32_t mrl = 0;
-			int32_t k = self->rnext[-1];
-			while (k >= 0)
-			{
-				int32_t nk = self->rnext[k];
-				int32_t n = self->rsize[k];
-				int32_t rr = self->i2r[k];
-				float32_t *d = self->rdata[k];
-				if (r1 < n)
-				{
-					if (r2 < n)
-					{
-						float32_t t1 = d[r1];
-						float32_t t2 = d[r2];
-						d[r1] = t2;
-						d[r2] = t1;
-					}
-					else if (rr == r2)
-					{
-						d[r1] = self->rdiag[k];
-					}
-					else
-					{
-						int32_t arsize = self->rsize[i2];
-						if (rr < arsize && rr != r1)
-							d[r1] = self->rdata[i2][rr];
-						else
-							xtruncate (self, k, r1);
-					}
-				}
-				else if (r2 < n)
-				{
-					if (rr == r1)
-					{
-						d[r2] = self->rdiag[k];
-					}
-					else
-					{
-						int32_t arsize = self->rsize[i1];
-						if (rr < arsize && rr != r2)
-							d[r2] = self->rdata[i1][rr];
-						else
-							xtruncate (self, k, r2);
-					}
-				}
-				mrl = Math::max (mrl, self->rsize[k]);
-				k = nk;
-			}
-			self->maxrowlen = mrl;
-		}
-		/* swap r2i and i2r */
 		self->r2i[r1] = i2;
 		self->r2i[r2] = i1;
 		self->i2r[i1] = r2;
@@ -293,131 +284,63 @@ namespace shogun
 
 	static void larank_kcache_swap_rr (larank_kcache_t * self, int32_t r1, int32_t r2)
 	{
-		xminsize (self, 1 + Math::max(r1, r2));
 		xswap (self, self->r2i[r1], self->r2i[r2], r1, r2);
 	}
 
 	static void larank_kcache_swap_ri (larank_kcache_t * self, int32_t r1, int32_t i2)
 	{
-		xminsize (self, 1 + Math::max (r1, i2));
 		xswap (self, self->r2i[r1], i2, r1, self->i2r[i2]);
 	}
 
-	static float64_t xquery (larank_kcache_t * self, int32_t i, int32_t j)
-	{
-		/* search buddies */
-		larank_kcache_t *cache = self->nextbuddy;
-		do
-		{
-			int32_t l = cache->l;
-			if (i < l && j < l)
-			{
-				int32_t s = cache->rsize[i];
-				int32_t p = cache->i2r[j];
-				if (p < s)
-					return cache->rdata[i][p];
-				if (i == j && s >= 0)
-					return cache->rdiag[i];
-				p = cache->i2r[i];
-				s = cache->rsize[j];
-				if (p < s)
-					return cache->rdata[j][p];
-			}
-			cache = cache->nextbuddy;
-		}
-		while (cache != self);
-		/* compute */
-		return self->func->kernel(i, j);
-	}
-
-
 	static float64_t larank_kcache_query (larank_kcache_t * self, int32_t i, int32_t j)
 	{
-		ASSERT (self)
-		ASSERT (i >= 0)
-		ASSERT (j >= 0)
-		return xquery (self, i, j);
+		return larank_krows_query (self->rows, i, j);
 	}
 
-
-	static void larank_kcache_set_buddy (larank_kcache_t * self, larank_kcache_t * buddy)
+	/* sum_r beta[r]*K(i, r2i[r]) for r < len without modifying the shared
+	 * rows, so it can be called concurrently. Values not cached are
+	 * computed but not stored, callers fill the rows beforehand with
+	 * larank_kcache_query_row. */
+	static float64_t larank_kcache_dot_row (const larank_kcache_t * self, int32_t i, const float32_t* beta, int32_t len)
 	{
-		larank_kcache_t *p = self;
-		larank_kcache_t *selflast = self->prevbuddy;
-		larank_kcache_t *buddylast = buddy->prevbuddy;
-		/* check functions are identical */
-		ASSERT (self->func == buddy->func)
-		/* make sure we are not already buddies */
-		do
+		const larank_krows_t *rows = self->rows;
+		const float32_t *d = rows->rdata[i];
+		float64_t sum = 0;
+		for (int32_t r = 0; r < len; r++)
 		{
-			if (p == buddy)
-				return;
-			p = p->nextbuddy;
+			int32_t j = self->r2i[r];
+			float64_t k;
+			if (d && !std::isnan (d[j]))
+				k = d[j];
+			else if (rows->rdata[j] && !std::isnan (rows->rdata[j][i]))
+				k = rows->rdata[j][i];
+			else
+				k = rows->func->kernel(i, j);
+			sum += beta[r] * k;
 		}
-		while (p != self);
-		/* link */
-		selflast->nextbuddy = buddy;
-		buddy->prevbuddy = selflast;
-		buddylast->nextbuddy = self;
-		self->prevbuddy = buddylast;
+		return sum;
 	}
 
-
-	static float32_t* larank_kcache_query_row (larank_kcache_t * self, int32_t i, int32_t len)
+	/* Row i of the shared store, K(i, r2i[r]) is found at r2i[r] for r < len */
+	static const float32_t* larank_kcache_query_row (larank_kcache_t * self, int32_t i, int32_t len)
 	{
-		ASSERT (i >= 0)
-		if (i < self->l && len <= self->rsize[i])
-		{
-			self->rnext[self->rprev[i]] = self->rnext[i];
-			self->rprev[self->rnext[i]] = self->rprev[i];
-		}
-		else
-		{
-			int32_t olen, p;
-			float32_t *d;
-			if (i >= self->l || len >= self->l)
-				xminsize (self, Math::max (1 + i, len));
-			olen = self->rsize[i];
-			if (olen < len)
-			{
-				if (olen < 0)
-				{
-					self->rdiag[i] = self->func->kernel(i, i);
-					olen = self->rsize[i] = 0;
-				}
-				xextend (self, i, len);
-				d = self->rdata[i];
-				self->rsize[i] = olen;
-				for (p = olen; p < len; p++)
-					d[p] = larank_kcache_query (self, self->r2i[p], i);
-				self->rsize[i] = len;
-			}
-			self->rnext[self->rprev[i]] = self->rnext[i];
-			self->rprev[self->rnext[i]] = self->rprev[i];
-			xpurge (self);
-		}
-		self->rprev[i] = -1;
-		self->rnext[i] = self->rnext[-1];
-		self->rnext[self->rprev[i]] = i;
-		self->rprev[self->rnext[i]] = i;
-		return self->rdata[i];
+		return larank_krows_query_row (self->rows, i, self->r2i, len);
 	}
 
 }
 
 
-// Initializing an output class (basically creating a kernel cache for it)
-void LaRankOutput::initialize (std::shared_ptr<Kernel> kfunc, int64_t cache)
+// Initializing an output class (basically creating a view of the shared kernel rows for it)
+void LaRankOutput::initialize (larank_krows_t * rows)
 {
-	kernel = larank_kcache_create (std::move(kfunc));
-	larank_kcache_set_maximum_size (kernel, cache * 1024 * 1024);
+	kernel = larank_kcache_create (rows);
 	m_beta = SGVector<float32_t>(1);
 	g = SG_MALLOC(float32_t, 1);
 	*g=0;
 	l = 0;
 }
 
-// Destroying an output class (basically destroying the kernel cache)
+// Destroying an output class (basically destroying its view of the kernel rows)
 void LaRankOutput::destroy ()
 {
 	larank_kcache_destroy (kernel);
@@ -433,28 +356,46 @@ float64_t LaRankOutput::computeScore (int32_t x_id)
 		return 0;
 	else
 	{
-		SGVector<float32_t> row(larank_kcache_query_row (kernel, x_id, l), l, false);
-		return linalg::dot (m_beta, row);
+		const float32_t *row = larank_kcache_query_row (kernel, x_id, l);
+		const int32_t *r2i = larank_kcache_r2i (kernel);
+		float64_t sum = 0;
+		for (int32_t r = 0; r < l; r++)
+			sum += m_beta[r] * row[r2i[r]];
+		return sum;
 	}
 }
 
+// Computes the kernel row needed to score x_id and keeps it in the shared rows
+void LaRankOutput::fillRow (int32_t x_id)
+{
+	if (l > 0)
+		larank_kcache_query_row (kernel, x_id, l);
+}
+
+// Same as computeScore, but leaves the kernel rows untouched (thread safe)
+float64_t LaRankOutput::computeScoreShared (int32_t x_id) const
+{
+	if (l == 0)
+		return 0;
+	return larank_kcache_dot_row (kernel, x_id, m_beta.vector, l);
+}
+
 // !Important! Computing the gradient of a given input vector for the actual output
 float64_t LaRankOutput::computeGradient (int32_t xi_id, int32_t yi, int32_t ythis)
 {
 	return (yi == ythis ? 1 : 0) - computeScore (xi_id);
 }
 
+// Same as computeGradient, but leaves the kernel rows untouched (thread safe)
+float64_t LaRankOutput::computeGradientShared (int32_t xi_id, int32_t yi, int32_t ythis) const
+{
+	return (yi == ythis ? 1 : 0) - computeScoreShared (xi_id);
+}
+
 // Updating the solution in the actual output
 void LaRankOutput::update (int32_t x_id, float64_t lambda, float64_t gp)
 {
-	int32_t *r2i = larank_kcache_r2i (kernel, l);
-	int64_t xr = l + 1;
-	for (int32_t r = 0; r < l; r++)
-		if (r2i[r] == x_id)
-		{
-			xr = r;
-			break;
-		}
+	int32_t xr = larank_kcache_rank (kernel, x_id);
 
 	// updates the cache order and the beta coefficient
 	if (xr < l)
@@ -472,21 +413,15 @@ void LaRankOutput::update (int32_t x_id, float64_t lambda, float64_t gp)
 	}
 
 	// update stored gradients
-	float32_t *row = larank_kcache_query_row (kernel, x_id, l);
+	const float32_t *row = larank_kcache_query_row (kernel, x_id, l);
+	const int32_t *r2i = larank_kcache_r2i (kernel);
 	for (int32_t r = 0; r < l; r++)
 	{
 		float64_t oldg = g[r];
-		g[r]=oldg - lambda * row[r];
+		g[r]=oldg - lambda * row[r2i[r]];
 	}
 }
 
-// Linking the cahe of this output to the cache of an other "buddy" output
-// so that if a requested value is not found in this cache, you can ask your buddy if it has it.
-void LaRankOutput::set_kernel_buddy (larank_kcache_t * bud)
-{
-	larank_kcache_set_buddy (bud, kernel);
-}
-
 // Removing useless support vectors (for which beta=0)
 int32_t LaRankOutput::cleanup ()
 {
@@ -524,12 +459,9 @@ int32_t LaRankOutput::cleanup ()
 float64_t LaRankOutput::getW2 ()
 {
 	float64_t sum = 0;
-	int32_t *r2i = larank_kcache_r2i (kernel, l + 1);
+	const int32_t *r2i = larank_kcache_r2i (kernel);
 	for (int32_t r = 0; r < l; r++)
-	{
-		SGVector<float32_t> row_r(larank_kcache_query_row (kernel, r2i[r], l), l, false);
-		sum += m_beta[r] * linalg::dot (m_beta, row_r);
-	}
+		sum += m_beta[r] * computeScore (r2i[r]);
 	return sum;
 }
 
@@ -539,50 +471,28 @@ float64_t LaRankOutput::getKii (int32_t x_id)
 }
 
 //
-float64_t LaRankOutput::getBeta (int32_t x_id)
+float64_t LaRankOutput::getBeta (int32_t x_id) const
 {
-	int32_t *r2i = larank_kcache_r2i (kernel, l);
-	int32_t xr = -1;
-	for (int32_t r = 0; r < l; r++)
-		if (r2i[r] == x_id)
-		{
-			xr = r;
-			break;
-		}
-	return (xr < 0 ? 0 : m_beta[xr]);
+	int32_t xr = larank_kcache_rank (kernel, x_id);
+	return (xr < l ? m_beta[xr] : 0);
 }
 
 //
-float64_t LaRankOutput::getGradient (int32_t x_id)
+float64_t LaRankOutput::getGradient (int32_t x_id) const
 {
-	int32_t *r2i = larank_kcache_r2i (kernel, l);
-	int32_t xr = -1;
-	for (int32_t r = 0; r < l; r++)
-		if (r2i[r] == x_id)
-		{
-			xr = r;
-			break;
-		}
-	return (xr < 0 ? 0 : g[xr]);
+	int32_t xr = larank_kcache_rank (kernel, x_id);
+	return (xr < l ? g[xr] : 0);
 }
 bool LaRankOutput::isSupportVector (int32_t x_id) const
 {
-	int32_t *r2i = larank_kcache_r2i (kernel, l);
-	int32_t xr = -1;
-	for (int32_t r = 0; r < l; r++)
-		if (r2i[r] == x_id)
-		{
-			xr = r;
-			break;
-		}
-	return (xr >= 0);
+	return larank_kcache_rank (kernel, x_id) < l;
 }
 
 //
 int32_t LaRankOutput::getSV (float32_t* &sv) const
 {
 	sv=SG_MALLOC(float32_t, l);
-	int32_t *r2i = larank_kcache_r2i (kernel, l);
+	int32_t *r2i = larank_kcache_r2i (kernel);
 	for (int32_t r = 0; r < l; r++)
 		sv[r]=r2i[r];
 	return l;
@@ -591,8 +501,8 @@ int32_t LaRankOutput::getSV (float32_t* &sv) const
 LaRank::LaRank (): RandomMixin<MulticlassSVM>(std::make_shared<MulticlassOneVsRestStrategy>()),
 	nb_seen_examples (0), nb_removed (0),
 	n_pro (0), n_rep (0), n_opt (0),
-	w_pro (1), w_rep (1), w_opt (1), y0 (0), m_dual (0),
-	batch_mode(true), step(0), max_iteration(1000)
+	w_pro (1), w_rep (1), w_opt (1), m_dual (0), kernel_rows (NULL),
+	batch_mode(true), step(0), max_iteration(1000), num_threads(1)
 {
 }
 
@@ -600,8 +510,8 @@ LaRank::LaRank (float64_t C, std::shared_ptr<Kernel> k ):
 	RandomMixin<MulticlassSVM>(std::make_shared<MulticlassOneVsRestStrategy>(), C, std::move(k)),
 	nb_seen_examples (0), nb_removed (0),
 	n_pro (0), n_rep (0), n_opt (0),
-	w_pro (1), w_rep (1), w_opt (1), y0 (0), m_dual (0),
-	batch_mode(true), step(0), max_iteration(1000)
+	w_pro (1), w_rep (1), w_opt (1), m_dual (0), kernel_rows (NULL),
+	batch_mode(true), step(0), max_iteration(1000), num_threads(1)
 {
 }
 
@@ -683,15 +593,14 @@ bool LaRank::train_machine(const std::shared_ptr<Features>& data, const std::sha
 	SG_DEBUG("{} classes", num_classes)
 
 	// Used for saving a model file
-	int32_t i=0;
-	for (outputhash_t::const_iterator it = outputs.begin (); it != outputs.end (); ++it)
+	for (int32_t i = 0; i < num_classes; i++)
 	{
-		const LaRankOutput* o=&(it->second);
+		const LaRankOutput* o=&outputs[i];
 
 		larank_kcache_t* k=o->getKernel();
 		int32_t l=o->get_l();
 		SGVector<float32_t> beta=o->getBetas();
-		int32_t *r2i = larank_kcache_r2i (k, l);
+		int32_t *r2i = larank_kcache_r2i (k);
 
 		ASSERT(l>0)
 		SG_DEBUG("svm[{}] has {} sv, b={}", i, l, 0.0)
@@ -706,7 +615,6 @@ bool LaRank::train_machine(const std::shared_ptr<Features>& data, const std::sha
 
 		svm->set_bias(0);
 		set_svm(i, svm);
-		i++;
 	}
 	destroy();
 
@@ -720,17 +628,27 @@ int32_t LaRank::add (int32_t x_id, int32_t yi)
 	// create a new output object if this one has never been seen before
 	if (!getOutput (yi))
 	{
-		outputs.insert (std::make_pair (yi, LaRankOutput ()));
-		LaRankOutput *cur = getOutput (yi);
-		cur->initialize (m_kernel, cache);
-		if (outputs.size () == 1)
-			y0 = outputs.begin ()->first;
-		// link the cache of this new output to a buddy
-		if (outputs.size () > 1)
+		// all the outputs share the kernel rows
+		if (!kernel_rows)
 		{
-			LaRankOutput *out0 = getOutput (y0);
-			cur->set_kernel_buddy (out0->getKernel ());
+			kernel_rows = larank_krows_create (m_kernel, m_kernel->get_num_vec_lhs());
+			larank_krows_set_maximum_size (kernel_rows, cache * 1024 * 1024);
+			kernel_rows->nthreads = num_threads;
 		}
+		require(yi >= 0, "LaRank: class labels must be non-negative (got {})", yi);
+
+		// keep the output table sorted by class label
+		int32_t pos = std::lower_bound (output_labels.begin (), output_labels.end (), yi)
+			- output_labels.begin ();
+		outputs.insert (outputs.begin () + pos, LaRankOutput ());
+		output_labels.insert (output_labels.begin () + pos, yi);
+
+		if (yi >= (int32_t) output_index.size ())
+			output_index.resize (yi + 1, -1);
+		for (uint32_t k = pos; k < outputs.size (); k++)
+			output_index[output_labels[k]] = k;
+
+		outputs[pos].initialize (kernel_rows);
 	}
 
 	LaRankPattern tpattern (x_id, yi);
@@ -796,13 +714,13 @@ int32_t LaRank::predict (int32_t x_id)
 {
 	int32_t res = -1;
 	float64_t score_max = -DBL_MAX;
-	for (outputhash_t::iterator it = outputs.begin (); it != outputs.end ();++it)
+	for (uint32_t k = 0; k < outputs.size (); k++)
 	{
-		float64_t score = it->second.computeScore (x_id);
+		float64_t score = outputs[k].computeScore (x_id);
 		if (score > score_max)
 		{
 			score_max = score;
-			res = it->first;
+			res = output_labels[k];
 		}
 	}
 	return res;
@@ -810,39 +728,91 @@ int32_t LaRank::predict (int32_t x_id)
 
 void LaRank::destroy ()
 {
-	for (outputhash_t::iterator it = outputs.begin (); it != outputs.end ();++it)
-		it->second.destroy ();
+	for (uint32_t k = 0; k < outputs.size (); k++)
+		outputs[k].destroy ();
 	outputs.clear();
+	output_labels.clear();
+	output_index.clear();
+	larank_krows_destroy (kernel_rows);
+	kernel_rows=NULL;
 }
 
 
-// Compute Duality gap (costly but used in stopping criteria in batch mode)
-float64_t LaRank::computeGap ()
+// Number of patterns whose kernel rows fit in the cache at the same time
+int32_t LaRank::getRowsPerBlock () const
 {
-	float64_t sum_sl = 0;
-	float64_t sum_bi = 0;
-	for (uint32_t i = 0; i < patterns.maxcount (); ++i)
+	if (!kernel_rows)
+		return Math::max (1, (int32_t) patterns.maxcount ());
+	int64_t row_size = (int64_t) kernel_rows->n * sizeof (float32_t);
+	int64_t rows = (kernel_rows->maxsize - (int64_t) sizeof (larank_krows_t)) / row_size;
+	return (int32_t) Math::max ((int64_t) 1, Math::min (rows, (int64_t) patterns.maxcount ()));
+}
+
+// Fills the kernel rows the outputs need to score the patterns [start, end)
+void LaRank::fillRows (int32_t start, int32_t end)
+{
+	for (int32_t i = start; i < end; ++i)
 	{
 		const LaRankPattern & p = patterns[i];
 		if (!p.exists ())
 			continue;
-		LaRankOutput *out = getOutput (p.y);
-		if (!out)
-			continue;
-		sum_bi += out->getBeta (p.x_id);
-		float64_t gi = out->computeGradient (p.x_id, p.y, p.y);
-		float64_t gmin = DBL_MAX;
-		for (outputhash_t::iterator it = outputs.begin (); it != outputs.end (); ++it)
+		for (uint32_t k = 0; k < outputs.size (); k++)
 		{
-			if (it->first != p.y && it->second.isSupportVector (p.x_id))
+			if (output_labels[k] == p.y || outputs[k].isSupportVector (p.x_id))
+				outputs[k].fillRow (p.x_id);
+		}
+	}
+}
+
+// Compute Duality gap (costly but used in stopping criteria in batch mode)
+float64_t LaRank::computeGap ()
+{
+	// the patterns are independent, so they are processed in parallel and
+	// the per pattern terms are summed up in order afterwards. The kernel
+	// rows of a block of patterns are filled first, so the threads only
+	// read cached values.
+	int32_t n = patterns.maxcount ();
+	std::vector<float64_t> sl (n, 0.0);
+	std::vector<float64_t> bi (n, 0.0);
+
+	int32_t block = getRowsPerBlock ();
+	for (int32_t start = 0; start < n; start += block)
+	{
+		int32_t end = Math::min (n, start + block);
+		fillRows (start, end);
+
+		#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(dynamic, 16)
+		for (int32_t i = start; i < end; ++i)
+		{
+			const LaRankPattern & p = patterns[i];
+			if (!p.exists ())
+				continue;
+			const LaRankOutput *out = getOutput (p.y);
+			if (!out)
+				continue;
+			bi[i] = out->getBeta (p.x_id);
+			float64_t gi = out->computeGradientShared (p.x_id, p.y, p.y);
+			float64_t gmin = DBL_MAX;
+			for (uint32_t k = 0; k < outputs.size (); k++)
 			{
-				float64_t g =
-					it->second.computeGradient (p.x_id, p.y, it->first);
-				if (g < gmin)
-					gmin = g;
+				if (output_labels[k] != p.y && outputs[k].isSupportVector (p.x_id))
+				{
+					float64_t g =
+						outputs[k].computeGradientShared (p.x_id, p.y, output_labels[k]);
+					if (g < gmin)
+						gmin = g;
+				}
 			}
+			sl[i] = Math::max (0.0, gi - gmin);
 		}
-		sum_sl += Math::max (0.0, gi - gmin);
+	}
+
+	float64_t sum_sl = 0;
+	float64_t sum_bi = 0;
+	for (int32_t i = 0; i < n; ++i)
+	{
+		sum_sl += sl[i];
+		sum_bi += bi[i];
 	}
 	return Math::max (0.0, computeW2 () + get_C() * sum_sl - sum_bi);
 }
@@ -862,14 +832,23 @@ void LaRank::set_max_iteration(int32_t max_iter)
     max_iteration = max_iter;
 }
 
+// Set the number of threads used to evaluate the kernel rows and the duality gap
+void LaRank::set_num_threads(int32_t n)
+{
+	require(n > 0, "Number of threads (given: {}) must be positive.", n);
+	num_threads = n;
+	if (kernel_rows)
+		kernel_rows->nthreads = n;
+}
+
 // Number of Support Vectors
 int32_t LaRank::getNSV ()
 {
 	int32_t res = 0;
-	for (outputhash_t::const_iterator it = outputs.begin (); it != outputs.end (); ++it)
+	for (uint32_t k = 0; k < outputs.size (); k++)
 	{
 		float32_t* sv=NULL;
-		res += it->second.getSV (sv);
+		res += outputs[k].getSV (sv);
 		SG_FREE(sv);
 	}
 	return res;
@@ -878,40 +857,71 @@ int32_t LaRank::getNSV ()
 // Norm of the parameters vector
 float64_t LaRank::computeW2 ()
 {
-	float64_t res = 0;
-	for (uint32_t i = 0; i < patterns.maxcount (); ++i)
+	int32_t n = patterns.maxcount ();
+	std::vector<float64_t> w2 (n, 0.0);
+
+	int32_t block = getRowsPerBlock ();
+	for (int32_t start = 0; start < n; start += block)
 	{
-		const LaRankPattern & p = patterns[i];
-		if (!p.exists ())
-			continue;
-		for (outputhash_t::iterator it = outputs.begin (); it != outputs.end (); ++it)
-			if (it->second.getBeta (p.x_id))
-				res += it->second.getBeta (p.x_id) * it->second.computeScore (p.x_id);
+		int32_t end = Math::min (n, start + block);
+		fillRows (start, end);
+
+		#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(dynamic, 16)
+		for (int32_t i = start; i < end; ++i)
+		{
+			const LaRankPattern & p = patterns[i];
+			if (!p.exists ())
+				continue;
+			for (uint32_t k = 0; k < outputs.size (); k++)
+			{
+				float64_t beta = outputs[k].getBeta (p.x_id);
+				if (beta)
+					w2[i] += beta * outputs[k].computeScoreShared (p.x_id);
+			}
+		}
 	}
+
+	float64_t res = 0;
+	for (int32_t i = 0; i < n; ++i)
+		res += w2[i];
 	return res;
 }
 
 // Compute Dual objective value
 float64_t LaRank::getDual ()
 {
-	float64_t res = 0;
-	for (uint32_t i = 0; i < patterns.maxcount (); ++i)
+	int32_t n = patterns.maxcount ();
+	std::vector<float64_t> bi (n, 0.0);
+
+	#pragma omp parallel for num_threads(num_threads) if (num_threads > 1)
+	for (int32_t i = 0; i < n; ++i)
 	{
 		const LaRankPattern & p = patterns[i];
 		if (!p.exists ())
 			continue;
-		LaRankOutput *out = getOutput (p.y);
-		if (!out)
-			continue;
-		res += out->getBeta (p.x_id);
+		const LaRankOutput *out = getOutput (p.y);
+		if (out)
+			bi[i] = out->getBeta (p.x_id);
 	}
+
+	float64_t res = 0;
+	for (int32_t i = 0; i < n; ++i)
+		res += bi[i];
 	return res - computeW2 () / 2;
 }
 
 LaRankOutput *LaRank::getOutput (int32_t index)
 {
-	outputhash_t::iterator it = outputs.find (index);
-	return it == outputs.end ()? NULL : &it->second;
+	if (index < 0 || index >= (int32_t) output_index.size () || output_index[index] < 0)
+		return NULL;
+	return &outputs[output_index[index]];
+}
+
+const LaRankOutput *LaRank::getOutput (int32_t index) const
+{
+	if (index < 0 || index >= (int32_t) output_index.size () || output_index[index] < 0)
+		return NULL;
+	return &outputs[output_index[index]];
 }
 
 // IMPORTANT Main SMO optimization step
@@ -925,18 +935,19 @@ LaRank::process_return_t LaRank::process (const LaRankPattern & pattern, process
 	std::vector < outputgradient_t > outputgradients(getNumOutputs ());
 	std::vector < outputgradient_t > outputscores(getNumOutputs ());
 
-	for (outputhash_t::iterator it = outputs.begin (); it != outputs.end (); ++it)
+	for (uint32_t k = 0; k < outputs.size (); k++)
 	{
+		int32_t y = output_labels[k];
 		if (ptype != processOptimize
-				|| it->second.isSupportVector (pattern.x_id))
+				|| outputs[k].isSupportVector (pattern.x_id))
 		{
 			float64_t g =
-				it->second.computeGradient (pattern.x_id, pattern.y, it->first);
-			outputgradients.push_back (outputgradient_t (it->first, g));
-			if (it->first == pattern.y)
-				outputscores.push_back (outputgradient_t (it->first, (1 - g)));
+				outputs[k].computeGradient (pattern.x_id, pattern.y, y);
+			outputgradients.push_back (outputgradient_t (y, g));
+			if (y == pattern.y)
+				outputscores.push_back (outputgradient_t (y, (1 - g)));
 			else
-				outputscores.push_back (outputgradient_t (it->first, -g));
+				outputscores.push_back (outputgradient_t (y, -g));
 		}
 	}
 
@@ -1062,14 +1073,14 @@ float64_t LaRank::optimize ()
 uint32_t LaRank::cleanup ()
 {
 	/*
-	for (outputhash_t::iterator it = outputs.begin (); it != outputs.end (); ++it)
-		it->second.cleanup ();
+	for (uint32_t k = 0; k < outputs.size (); k++)
+		outputs[k].cleanup ();
 
 	uint32_t res = 0;
 	for (uint32_t i = 0; i < patterns.size (); ++i)
 	{
 		LaRankPattern & p = patterns[i];
-		if (p.exists () && !outputs[p.y].isSupportVector (p.x_id))
+		if (p.exists () && !getOutput (p.y)->isSupportVector (p.x_id))
 		{
 			patterns.remove (i);
 			++res;
@@ -68,22 +68,17 @@
 namespace shogun
 {
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
-	struct larank_kcache_s;
-	typedef struct larank_kcache_s larank_kcache_t;
-	struct larank_kcache_s
+	struct larank_krows_s;
+	typedef struct larank_krows_s larank_krows_t;
+	struct larank_krows_s
 	{
 		std::shared_ptr<Kernel> func;
-		larank_kcache_t *prevbuddy;
-		larank_kcache_t *nextbuddy;
 		int64_t maxsize;
 		int64_t cursize;
-		int32_t l;
-		int32_t *i2r;
-		int32_t *r2i;
-		int32_t maxrowlen;
-		/* Rows */
-		int32_t *rsize;
-		float32_t *rdiag;
+		int32_t n;
+		/* Threads used to compute the missing entries of a row */
+		int32_t nthreads;
+		/* Rows, keyed by example index */
 		float32_t **rdata;
 		int32_t *rnext;
 		int32_t *rprev;
@@ -91,6 +86,16 @@ namespace shogun
 		int32_t *qprev;
 	};
 
+	struct larank_kcache_s;
+	typedef struct larank_kcache_s larank_kcache_t;
+	struct larank_kcache_s
+	{
+		larank_krows_t *rows;
+		int32_t l;
+		int32_t *i2r;
+		int32_t *r2i;
+	};
+
 	/*
 	 ** OUTPUT: one per class of the raining set, keep tracks of support
 	 * vectors and their beta coefficients
@@ -101,31 +106,60 @@ namespace shogun
 			LaRankOutput () : g(NULL), kernel(NULL), l(0)
 		{
 		}
+			// Outputs own their buffers, so they can be moved but not copied
+			LaRankOutput (LaRankOutput && o) noexcept
+				: m_beta(o.m_beta), g(o.g), kernel(o.kernel), l(o.l)
+			{
+				o.g = NULL;
+				o.kernel = NULL;
+				o.l = 0;
+			}
+			LaRankOutput & operator = (LaRankOutput && o) noexcept
+			{
+				if (this != &o)
+				{
+					destroy();
+					m_beta = o.m_beta;
+					g = o.g;
+					kernel = o.kernel;
+					l = o.l;
+					o.g = NULL;
+					o.kernel = NULL;
+					o.l = 0;
+				}
+				return *this;
+			}
+			LaRankOutput (const LaRankOutput &) = delete;
+			LaRankOutput & operator = (const LaRankOutput &) = delete;
 			virtual ~LaRankOutput ()
 			{
 				destroy();
 			}
 
-			// Initializing an output class (basically creating a kernel cache for it)
-			void initialize (std::shared_ptr<Kernel> kfunc, int64_t cache);
+			// Initializing an output class (basically creating a view of the shared kernel rows for it)
+			void initialize (larank_krows_t * rows);
 
-			// Destroying an output class (basically destroying the kernel cache)
+			// Destroying an output class (basically destroying its view of the kernel rows)
 			void destroy ();
 
 			// !Important! Computing the score of a given input vector for the actual output
 			float64_t computeScore (int32_t x_id);
 
+			// Computes the kernel row needed to score x_id and keeps it in the shared rows
+			void fillRow (int32_t x_id);
+
+			// Same as computeScore, but leaves the kernel rows untouched (thread safe)
+			float64_t computeScoreShared (int32_t x_id) const;
+
 			// !Important! Computing the gradient of a given input vector for the actual output
 			float64_t computeGradient (int32_t xi_id, int32_t yi, int32_t ythis);
 
+			// Same as computeGradient, but leaves the kernel rows untouched (thread safe)
+			float64_t computeGradientShared (int32_t xi_id, int32_t yi, int32_t ythis) const;
+
 			// Updating the solution in the actual output
 			void update (int32_t x_id, float64_t lambda, float64_t gp);
 
-			// Linking the cache of this output to the cache of an other "buddy" output
-			// so that if a requested value is not found in this cache, you can
-			// ask your buddy if it has it.
-			void set_kernel_buddy (larank_kcache_t * bud);
-
 			// Removing useless support vectors (for which beta=0)
 			int32_t cleanup ();
 
@@ -149,7 +183,7 @@ namespace shogun
 			float64_t getKii (int32_t x_id);
 
 			//
-			float64_t getBeta (int32_t x_id);
+			float64_t getBeta (int32_t x_id) const;
 
 			//
 			inline SGVector<float32_t> getBetas () const
@@ -158,7 +192,7 @@ namespace shogun
 			}
 
 			//
-			float64_t getGradient (int32_t x_id);
+			float64_t getGradient (int32_t x_id) const;
 
 			//
 			bool isSupportVector (int32_t x_id) const;
@@ -171,7 +205,7 @@ namespace shogun
 			// this parameters
 			SGVector<float32_t> m_beta;		// Beta coefficiens
 			float32_t* g;		// Strored gradient derivatives
-			larank_kcache_t *kernel;	// Cache for kernel values
+			larank_kcache_t *kernel;	// View of the shared kernel rows
 			int32_t l;			// Number of support vectors
 	};
 
@@ -403,6 +437,17 @@ namespace shogun
 			 */
 			int32_t get_max_iteration() { return max_iteration; }
 
+			/** Set the number of threads used to compute kernel rows and
+			 * the duality gap
+			 * @param n number of threads
+			 */
+			void set_num_threads(int32_t n);
+
+			/** Get the number of threads
+			 * @return number of threads
+			 */
+			int32_t get_num_threads() const { return num_threads; }
+
 		protected:
 			/** train machine */
 			bool train_machine(const std::shared_ptr<Features>& data, const std::shared_ptr<Labels>& labs) override;
@@ -412,14 +457,24 @@ namespace shogun
 			 ** MAIN DARK OPTIMIZATION PROCESSES
 			 */
 
-			// Hash Table used to store the different outputs
-			/** output hash */
-			typedef std_hash_map < int32_t, LaRankOutput > outputhash_t;	// class index -> LaRankOutput
-
+			// Table of the different outputs, sorted by class label
 			/** outputs */
-			outputhash_t outputs;
+			std::vector < LaRankOutput > outputs;
+
+			/** class label of each output */
+			std::vector < int32_t > output_labels;
+
+			/** class label -> position in outputs, -1 if not seen yet */
+			std::vector < int32_t > output_index;
 
 			LaRankOutput *getOutput (int32_t index);
+			const LaRankOutput *getOutput (int32_t index) const;
+
+			// Number of patterns whose kernel rows fit in the cache together
+			int32_t getRowsPerBlock () const;
+
+			// Fills the kernel rows needed to score the patterns [start, end)
+			void fillRows (int32_t start, int32_t end);
 
 			//
 			LaRankPatterns patterns;
@@ -438,9 +493,11 @@ namespace shogun
 			float64_t w_rep;
 			float64_t w_opt;
 
-			int32_t y0;
 			float64_t m_dual;
 
+			// Kernel rows shared by all the outputs
+			larank_krows_t *kernel_rows;
+
 			struct outputgradient_t
 			{
 				outputgradient_t (int32_t result_output, float64_t result_gradient)
@@ -512,6 +569,9 @@ namespace shogun
 
 			/// Max number of iterations before training is stopped
 			int32_t max_iteration;
+
+			/// number of threads
+			int32_t num_threads;
 	};
 }
 #endif // LARANK_H
@@ -15,6 +15,7 @@
 #include <shogun/mathematics/Math.h>
 #include <shogun/labels/MulticlassLabels.h>
 #include <shogun/lib/slep/slep_mc_plain_lr.h>
+#include <shogun/lib/slep/slep_solver.h>
 
 #include <utility>
 
@@ -40,6 +41,9 @@ void MulticlassLogisticRegression::init_defaults()
 	set_z(0.1);
 	set_epsilon(1e-2);
 	set_max_iter(10000);
+	set_num_threads(1);
+	set_path_size(1);
+	set_path_ratio(0.01);
 }
 
 void MulticlassLogisticRegression::register_parameters()
@@ -47,6 +51,9 @@ void MulticlassLogisticRegression::register_parameters()
 	SG_ADD(&m_z, "m_z", "regularization constant", ParameterProperties::HYPER);
 	SG_ADD(&m_epsilon, "m_epsilon", "tolerance epsilon");
 	SG_ADD(&m_max_iter, "m_max_iter", "max number of iterations");
+	SG_ADD(&m_num_threads, "m_num_threads", "number of threads");
+	SG_ADD(&m_path_size, "m_path_size", "number of regularization path values");
+	SG_ADD(&m_path_ratio, "m_path_ratio", "ratio of the smallest and the largest z of the path");
 }
 
 MulticlassLogisticRegression::~MulticlassLogisticRegression()
@@ -79,10 +86,44 @@ bool MulticlassLogisticRegression::train_machine(const std::shared_ptr<Features>
 	}
 	options.tolerance = m_epsilon;
 	options.max_iter = m_max_iter;
-	slep_result_t result = slep_mc_plain_lr(data->as<DotFeatures>(),mc_labels,m_z,options);
+	options.n_threads = m_num_threads;
 
-	SGMatrix<float64_t> all_w = result.w;
-	SGVector<float64_t> all_c = result.c;
+	m_path_w.clear();
+	m_path_c.clear();
+	if (m_path_size>1)
+	{
+		std::vector<slep_result_t> path = slep_mc_plain_lr_path(data->as<DotFeatures>(),mc_labels,get_path_z(),options);
+		for (const auto& result : path)
+		{
+			m_path_w.push_back(result.w);
+			m_path_c.push_back(result.c);
+		}
+		select_path_solution(m_path_size-1);
+	}
+	else
+	{
+		slep_result_t result = slep_mc_plain_lr(data->as<DotFeatures>(),mc_labels,m_z,options);
+		set_solution(result.w, result.c);
+	}
+	return true;
+}
+
+SGVector<float64_t> MulticlassLogisticRegression::get_path_z() const
+{
+	return slep_z_path(m_z, m_path_ratio, m_path_size);
+}
+
+void MulticlassLogisticRegression::select_path_solution(int32_t i)
+{
+	require(i>=0 && i<(int32_t)m_path_w.size(), "Path solution {} is not available", i);
+	set_solution(m_path_w[i], m_path_c[i]);
+}
+
+void MulticlassLogisticRegression::set_solution(SGMatrix<float64_t> all_w, SGVector<float64_t> all_c)
+{
+	int32_t n_feats = all_w.num_rows;
+	int32_t n_classes = all_w.num_cols;
+	m_machines.clear();
 	for (int32_t i=0; i<n_classes; i++)
 	{
 		SGVector<float64_t> w(n_feats);
@@ -94,5 +135,4 @@ bool MulticlassLogisticRegression::train_machine(const std::shared_ptr<Features>
 		machine->set_bias(c);
 		m_machines.push_back(machine);
 	}
-	return true;
 }
@@ -15,6 +15,8 @@
 #include <shogun/features/DotFeatures.h>
 #include <shogun/machine/LinearMulticlassMachine.h>
 
+#include <vector>
+
 namespace shogun
 {
 
@@ -82,6 +84,63 @@ class MulticlassLogisticRegression : public LinearMulticlassMachine
 		 */
 		inline int32_t get_max_iter() const { return m_max_iter; }
 
+		/** set number of threads
+		 * @param num_threads number of threads used to compute the
+		 * class outputs and the gradient
+		 */
+		inline void set_num_threads(int32_t num_threads)
+		{
+			require(num_threads > 0, "Number of threads must be positive");
+			m_num_threads = num_threads;
+		}
+		/** get number of threads
+		 * @return number of threads
+		 */
+		inline int32_t get_num_threads() const { return m_num_threads; }
+
+		/** set number of z values on the regularization path
+		 *
+		 * With more than one value, training solves the problem for a
+		 * geometric sequence of z from z down to z*path_ratio, warm
+		 * starting each solve from the previous solution and discarding
+		 * the features that fail the sequential strong rule. The
+		 * machines of the smallest z are kept.
+		 *
+		 * @param path_size path size value
+		 */
+		inline void set_path_size(int32_t path_size)
+		{
+			ASSERT(path_size>0)
+			m_path_size = path_size;
+		}
+		/** get path size
+		 * @return path size value
+		 */
+		inline int32_t get_path_size() const { return m_path_size; }
+
+		/** set ratio of the smallest and the largest z of the path
+		 * @param path_ratio path ratio value
+		 */
+		inline void set_path_ratio(float64_t path_ratio)
+		{
+			ASSERT(path_ratio>0 && path_ratio<=1)
+			m_path_ratio = path_ratio;
+		}
+		/** get path ratio
+		 * @return path ratio value
+		 */
+		inline float64_t get_path_ratio() const { return m_path_ratio; }
+
+		/** get z values of the regularization path
+		 * @return z values
+		 */
+		SGVector<float64_t> get_path_z() const;
+
+		/** set machines to the solution for a path value
+		 * @param i index of the value in get_path_z()
+		 */
+		void select_path_solution(int32_t i);
+
 	protected:
 
 		/** train machine */
@@ -95,6 +154,9 @@ private:
 		/** register parameters */
 		void register_parameters();
 
+		/** set machines from weights and biases of all classes */
+		void set_solution(SGMatrix<float64_t> all_w, SGVector<float64_t> all_c);
+
 protected:
 
 		/** regularization constant for each machine */
@@ -106,6 +168,21 @@ protected:
 		/** max number of iterations */
 		int32_t m_max_iter;
 
+		/** number of threads */
+		int32_t m_num_threads;
+
+		/** number of regularization path values */
+		int32_t m_path_size;
+
+		/** ratio of the smallest and the largest z of the path */
+		float64_t m_path_ratio;
+
+		/** weights along the regularization path */
+		std::vector<SGMatrix<float64_t>> m_path_w;
+
+		/** biases along the regularization path */
+		std::vector<SGVector<float64_t>> m_path_c;
+
 };
 }
 #endif
@@ -83,6 +83,44 @@ struct BmrmStatistics
 
 	/** getter for hist_wdist */
 	SGVector< float64_t > get_hist_wdist_vector() const { return hist_wdist; };
+
+	/** Track of the wall-clock time [s] spent in the risk computation in
+	 * individual iterations (kept by the BMRM solver only) */
+	SGVector< float64_t > hist_time_risk;
+
+	/** getter for hist_time_risk */
+	SGVector< float64_t > get_hist_time_risk_vector() const { return hist_time_risk; };
+
+	/** Track of the wall-clock time [s] spent in the update of H */
+	SGVector< float64_t > hist_time_H;
+
+	/** getter for hist_time_H */
+	SGVector< float64_t > get_hist_time_H_vector() const { return hist_time_H; };
+
+	/** Track of the wall-clock time [s] spent in the inner QP solver */
+	SGVector< float64_t > hist_time_qp;
+
+	/** getter for hist_time_qp */
+	SGVector< float64_t > get_hist_time_qp_vector() const { return hist_time_qp; };
+
+	/** Track of the wall-clock time [s] spent in the update of W */
+	SGVector< float64_t > hist_time_W;
+
+	/** getter for hist_time_W */
+	SGVector< float64_t > get_hist_time_W_vector() const { return hist_time_W; };
+
+	/** Track of the wall-clock time [s] spent in the inactive cutting
+	 * plane removal */
+	SGVector< float64_t > hist_time_cleanup;
+
+	/** getter for hist_time_cleanup */
+	SGVector< float64_t > get_hist_time_cleanup_vector() const { return hist_time_cleanup; };
+
+	/** Track of the number of iterations of the inner QP solver */
+	SGVector< uint32_t > hist_qp_iters;
+
+	/** getter for hist_qp_iters */
+	SGVector< uint32_t > get_hist_qp_iters_vector() const { return hist_qp_iters; };
 };
 
 }
@@ -0,0 +1,74 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef BMRM_WARM_START_H_
+#define BMRM_WARM_START_H_
+
+#include <shogun/lib/config.h>
+#ifdef USE_GPL_SHOGUN
+
+#include <shogun/lib/common.h>
+#include <shogun/lib/SGMatrix.h>
+#include <shogun/lib/SGSparseVector.h>
+#include <shogun/lib/SGVector.h>
+
+#include <vector>
+
+namespace shogun
+{
+
+/** Cutting planes of a finished BMRM run used to warm start the next run.
+ *
+ * The cutting planes and their offsets do not depend on the regularization
+ * constant lambda, the Hessian of the reduced problem is their Gram matrix
+ * scaled by 1/lambda. Hence a run with another lambda can start from the
+ * kept cutting planes and the previous solution.
+ */
+struct BmrmWarmStart
+{
+	/** constructor */
+	BmrmWarmStart()
+	{
+		nCP = 0;
+	};
+
+	/** destructor */
+	virtual ~BmrmWarmStart() { };
+
+	/** drop the kept cutting planes */
+	void reset()
+	{
+		nCP = 0;
+		A = SGMatrix< float64_t >();
+		sparse_A.clear();
+		b = SGVector< float64_t >();
+		G = SGMatrix< float64_t >();
+		beta = SGVector< float64_t >();
+	};
+
+	/** number of kept cutting planes */
+	uint32_t nCP;
+
+	/** dense cutting planes, one per column */
+	SGMatrix< float64_t > A;
+
+	/** sparse cutting planes, used instead of A for sparse storage */
+	std::vector< SGSparseVector< float64_t > > sparse_A;
+
+	/** offsets of the cutting planes */
+	SGVector< float64_t > b;
+
+	/** Gram matrix of the cutting planes (Hessian times lambda) */
+	SGMatrix< float64_t > G;
+
+	/** solution of the reduced problem */
+	SGVector< float64_t > beta;
+};
+
+}
+#endif //USE_GPL_SHOGUN
+#endif
@@ -60,6 +60,9 @@ void DualLibQPBMSOSVM::init()
 	SG_ADD(&m_K, "m_K", "Parameter K");
 	SG_ADD(&m_Tmax, "m_Tmax", "Parameter Tmax", ParameterProperties::HYPER);
 	SG_ADD(&m_cp_models, "m_cp_models", "Number of cutting plane models");
+	SG_ADD(&m_num_threads, "m_num_threads", "Number of threads for the risk evaluation");
+	SG_ADD(&m_sparse_cps, "m_sparse_cps", "Sparse cutting plane storage flag");
+	SG_ADD(&m_warm_start, "m_warm_start", "Keep cutting planes between trainings");
 
 	// TODO(gf712) should be replaced with an extension of Constraint class
 	// which has a customisation point with lambdas, rather than write a whole struct
@@ -82,6 +85,9 @@ void DualLibQPBMSOSVM::init()
 	set_K(0.4);
 	set_Tmax(100);
 	set_cp_models(1);
+	set_num_threads(1);
+	set_sparse_cutting_planes(false);
+	set_warm_start(false);
 	set_store_train_info(false);
 	set_solver(BMRM);
 }
@@ -96,7 +102,10 @@ bool DualLibQPBMSOSVM::train_machine(std::shared_ptr<Features> data)
 	}
 
 	if (data)
+	{
 		set_features(data);
+		reset_warm_start();
+	}
 
 	if (m_verbose||m_store_train_info)
 	{
@@ -111,22 +120,23 @@ bool DualLibQPBMSOSVM::train_machine(std::shared_ptr<Features> data)
 		case BMRM:
 			m_result=svm_bmrm_solver(this, m_w, m_TolRel, m_TolAbs,
 					m_lambda, m_BufSize, m_cleanICP, m_cleanAfter, m_K, m_Tmax,
-					m_store_train_info);
+					m_store_train_info, m_num_threads, m_sparse_cps,
+					m_warm_start ? &m_warm_start_state : NULL);
 			break;
 		case PPBMRM:
 			m_result=svm_ppbm_solver(this, m_w, m_TolRel, m_TolAbs,
 					m_lambda, m_BufSize, m_cleanICP, m_cleanAfter, m_K, m_Tmax,
-					m_verbose);
+					m_verbose, m_num_threads);
 			break;
 		case P3BMRM:
 			m_result=svm_p3bm_solver(this, m_w, m_TolRel, m_TolAbs,
 					m_lambda, m_BufSize, m_cleanICP, m_cleanAfter, m_K, m_Tmax,
-					m_cp_models, m_verbose);
+					m_cp_models, m_verbose, m_num_threads);
 			break;
 		case NCBM:
 			m_result=svm_ncbm_solver(this, m_w, m_TolRel, m_TolAbs,
 					m_lambda, m_BufSize, m_cleanICP, m_cleanAfter, true /* convex */,
-					true /* use line search*/, m_verbose);
+					true /* use line search*/, m_verbose, m_num_threads);
 			break;
 		default:
 			error("DualLibQPBMSOSVM: m_solver={} is not supported", m_solver);
@@ -17,6 +17,7 @@
 #include <shogun/machine/LinearStructuredOutputMachine.h>
 #include <shogun/features/DotFeatures.h>
 #include <shogun/structure/BmrmStatistics.h>
+#include <shogun/structure/BmrmWarmStart.h>
 
 namespace shogun
 {
@@ -184,6 +185,78 @@ class DualLibQPBMSOSVM : public LinearStructuredOutputMachine
 		 */
 		inline uint32_t get_cp_models() { return m_cp_models; }
 
+		/** set number of threads used for the risk evaluation
+		 *
+		 * All solvers shard the training examples across up to num_threads
+		 * threads when computing the risk and its subgradient, the P3BMRM
+		 * solver evaluates its cutting plane models concurrently if there
+		 * are enough of them. The argmax of the structured model must be
+		 * safe to call from several threads when num_threads > 1. A single
+		 * thread reproduces the serial solver exactly.
+		 *
+		 * @param num_threads	Number of threads
+		 */
+		inline void set_num_threads(int32_t num_threads)
+		{
+			require(num_threads > 0, "Number of threads must be positive!\n");
+			m_num_threads=num_threads;
+		}
+
+		/** get number of threads used for the risk evaluation
+		 *
+		 * @return Number of threads
+		 */
+		inline int32_t get_num_threads() { return m_num_threads; }
+
+		/** set sparse cutting plane storage flag
+		 *
+		 * The BMRM solver stores the cutting planes as sparse vectors if
+		 * enabled, which reduces the memory of the cutting plane buffer by
+		 * orders of magnitude for subgradients with few non-zero elements
+		 * and thus allows larger BufSize. The other solvers ignore it.
+		 *
+		 * @param sparse_cps	Flag enabling/disabling sparse cutting planes
+		 */
+		inline void set_sparse_cutting_planes(bool sparse_cps) { m_sparse_cps=sparse_cps; }
+
+		/** get sparse cutting plane storage flag
+		 *
+		 * @return Whether the cutting planes are stored as sparse vectors
+		 */
+		inline bool get_sparse_cutting_planes() { return m_sparse_cps; }
+
+		/** set warm start flag
+		 *
+		 * If enabled, the BMRM solver keeps its cutting planes and the
+		 * solution of the reduced problem after training and starts the
+		 * next training from them. The cutting planes do not depend on
+		 * lambda, which makes training for a sequence of lambda values
+		 * (e.g. in model selection) much cheaper than training each of
+		 * them from scratch. The other solvers ignore it.
+		 *
+		 * @param warm_start	Flag enabling/disabling warm start
+		 */
+		inline void set_warm_start(bool warm_start)
+		{
+			m_warm_start=warm_start;
+
+			if (!warm_start)
+				reset_warm_start();
+		}
+
+		/** get warm start flag
+		 *
+		 * @return Whether the cutting planes are kept between trainings
+		 */
+		inline bool get_warm_start() { return m_warm_start; }
+
+		/** drop the cutting planes kept for warm start
+		 *
+		 * Has to be called whenever the training data or the structured
+		 * model change, since the kept cutting planes are then invalid.
+		 */
+		inline void reset_warm_start() { m_warm_start_state.reset(); }
+
 		/** get bmrm result
 		 *
 		 * @return Result returned from Bundle Method algorithm
@@ -270,6 +343,18 @@ class DualLibQPBMSOSVM : public LinearStructuredOutputMachine
 		/** number of cutting plane models */
 		uint32_t m_cp_models;
 
+		/** number of threads for the risk evaluation */
+		int32_t m_num_threads;
+
+		/** store cutting planes as sparse vectors */
+		bool m_sparse_cps;
+
+		/** keep cutting planes between trainings */
+		bool m_warm_start;
+
+		/** cutting planes kept for warm start */
+		BmrmWarmStart m_warm_start_state;
+
 		/** BMRM result */
 		BmrmStatistics m_result;
 
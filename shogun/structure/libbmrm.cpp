@@ -13,21 +13,115 @@
 
 #include <shogun/structure/libbmrm.h>
 #ifdef USE_GPL_SHOGUN
-#include <shogun/lib/external/libqp.h>
 #include <shogun/lib/Time.h>
 #include <shogun/mathematics/Math.h>
+#include <shogun/mathematics/eigen3.h>
 #include <shogun/mathematics/linalg/LinalgNamespace.h>
 
 #include <climits>
 #include <limits>
+#include <vector>
+
+using namespace Eigen;
 
 namespace shogun
 {
 static const uint32_t QPSolverMaxIter=0xFFFFFFFF;
 static const float64_t epsilon=0.0;
 
-static float64_t *H;
-uint32_t BufSize;
+/* closure of the QP solver running in the current thread */
+static thread_local const bmrm_get_col_fn* active_get_col=NULL;
+
+/*----------------------------------------------------------------------
+  Returns pointer at i-th column of Hessian matrix of the active solver.
+  ----------------------------------------------------------------------*/
+static const float64_t *get_active_col(uint32_t i)
+{
+	return (*active_get_col)(i);
+}
+
+libqp_state_T bmrm_splx_solver(
+		const bmrm_get_col_fn& get_col,
+		float64_t*	diag_H,
+		float64_t*	f,
+		float64_t*	b,
+		uint32_t*	I,
+		uint8_t*	S,
+		float64_t*	x,
+		uint32_t	n,
+		uint32_t	MaxIter,
+		float64_t	TolAbs,
+		float64_t	TolRel,
+		float64_t	QP_TH)
+{
+	const bmrm_get_col_fn* prev_get_col=active_get_col;
+	active_get_col=&get_col;
+
+	libqp_state_T state=libqp_splx_solver(&get_active_col, diag_H, f, b, I, S,
+			x, n, MaxIter, TolAbs, TolRel, QP_TH, NULL);
+
+	active_get_col=prev_get_col;
+	return state;
+}
+
+float64_t bmrm_risk(
+		DualLibQPBMSOSVM*		machine,
+		SGVector<float64_t>&	subgrad,
+		SGVector<float64_t>&	W,
+		TMultipleCPinfo*		info,
+		uint32_t				num_threads)
+{
+	if (num_threads<=1)
+		return machine->risk(subgrad, W, info);
+
+	uint32_t from=0, N=0;
+
+	if (info)
+	{
+		from=info->m_from;
+		N=info->m_N;
+	}
+	else
+	{
+		N=machine->get_model()->get_features()->get_num_vectors();
+	}
+
+	uint32_t num_shards=Math::min(num_threads, N);
+
+	if (num_shards<=1)
+		return machine->risk(subgrad, W, info);
+
+	TMultipleCPinfo* shards=(TMultipleCPinfo*) LIBBMRM_CALLOC(num_shards, TMultipleCPinfo);
+	std::vector<SGVector<float64_t>> subgrad_s(num_shards);
+	SGVector<float64_t> R_s(num_shards);
+
+	for (uint32_t s=0; s<num_shards; ++s)
+	{
+		shards[s].m_from=from+uint32_t((uint64_t(N)*s)/num_shards);
+		shards[s].m_N=from+uint32_t((uint64_t(N)*(s+1))/num_shards)-shards[s].m_from;
+		subgrad_s[s]=(s==0) ? subgrad : SGVector<float64_t>(subgrad.vlen);
+	}
+
+	#pragma omp parallel for schedule(dynamic) num_threads(num_shards)
+	for (int32_t s=0; s<(int32_t)num_shards; ++s)
+		R_s[s]=machine->risk(subgrad_s[s], W, &shards[s]);
+
+	/* pairwise tree reduction into the first shard, i.e. into subgrad */
+	for (uint32_t stride=1; stride<num_shards; stride*=2)
+	{
+		#pragma omp parallel for num_threads(num_shards)
+		for (int32_t s=0; s<(int32_t)(num_shards-stride); s+=2*stride)
+		{
+			SGVector<float64_t>::vec1_plus_scalar_times_vec2(subgrad_s[s].vector,
+					1.0, subgrad_s[s+stride].vector, subgrad.vlen);
+			R_s[s]+=R_s[s+stride];
+		}
+	}
+
+	LIBBMRM_FREE(shards);
+
+	return R_s[0];
+}
 
 void add_cutting_plane(
 		bmrm_ll**	tail,
@@ -59,19 +153,109 @@ void add_cutting_plane(
 	*tail=cp;
 }
 
-void remove_cutting_plane(
-		bmrm_ll**	head,
+/*----------------------------------------------------------------------
+  Dot product of a sparse cutting plane with a dense vector.
+  ----------------------------------------------------------------------*/
+static float64_t sparse_cutting_plane_dot(
+		const SGSparseVector<float64_t>& cp,
+		const float64_t* x)
+{
+	float64_t rsum=0.0;
+
+	for (index_t k=0; k<cp.num_feat_entries; ++k)
+		rsum+=cp.features[k].entry*x[cp.features[k].feat_index];
+
+	return rsum;
+}
+
+/*----------------------------------------------------------------------
+  Adds alpha times a sparse cutting plane to a dense vector.
+  ----------------------------------------------------------------------*/
+static void sparse_cutting_plane_axpy(
+		float64_t alpha,
+		const SGSparseVector<float64_t>& cp,
+		float64_t* x)
+{
+	for (index_t k=0; k<cp.num_feat_entries; ++k)
+		x[cp.features[k].feat_index]+=alpha*cp.features[k].entry;
+}
+
+SGSparseVector<float64_t> sparse_cutting_plane(
+		const float64_t*	cp_data,
+		uint32_t	dim)
+{
+	index_t nnz=0;
+
+	for (uint32_t j=0; j<dim; ++j)
+	{
+		if (cp_data[j]!=0.0)
+			++nnz;
+	}
+
+	SGSparseVector<float64_t> cp(nnz);
+
+	for (uint32_t j=0, k=0; j<dim; ++j)
+	{
+		if (cp_data[j]!=0.0)
+		{
+			cp.features[k].feat_index=j;
+			cp.features[k].entry=cp_data[j];
+			++k;
+		}
+	}
+
+	return cp;
+}
+
+void add_sparse_cutting_plane(
 		bmrm_ll**	tail,
 		bool*		map,
-		float64_t*	icp)
+		SGSparseVector<float64_t>*	A,
+		uint32_t	free_idx,
+		const float64_t*	cp_data,
+		uint32_t	dim)
 {
-	bmrm_ll *cp_list_ptr=*head;
+	add_sparse_cutting_plane(tail, map, A, free_idx,
+			sparse_cutting_plane(cp_data, dim));
+}
+
+void add_sparse_cutting_plane(
+		bmrm_ll**	tail,
+		bool*		map,
+		SGSparseVector<float64_t>*	A,
+		uint32_t	free_idx,
+		const SGSparseVector<float64_t>&	cp_data)
+{
+	require(map[free_idx],
+		"add_sparse_cutting_plane: CP index {} is not free", free_idx);
+
+	A[free_idx]=cp_data;
+	map[free_idx]=false;
+
+	bmrm_ll *cp=(bmrm_ll*)LIBBMRM_CALLOC(1, bmrm_ll);
 
-	while(cp_list_ptr->address != icp)
+	if (cp==NULL)
 	{
-		cp_list_ptr=cp_list_ptr->next;
+		error("Out of memory.");
+		return;
 	}
 
+	cp->address=NULL;
+	cp->prev=*tail;
+	cp->next=NULL;
+	cp->idx=free_idx;
+	(*tail)->next=cp;
+	*tail=cp;
+}
+
+void remove_cutting_plane(
+		bmrm_ll**	head,
+		bmrm_ll**	tail,
+		bool*		map,
+		bmrm_ll*	icp)
+{
+	bmrm_ll *cp_list_ptr=icp;
+
 	if (cp_list_ptr==*head)
 	{
 		*head=(*head)->next;
@@ -92,6 +276,58 @@ void remove_cutting_plane(
 	LIBBMRM_FREE(cp_list_ptr);
 }
 
+void compact_cutting_planes(
+		bmrm_ll*	head,
+		bool*		map,
+		float64_t*	A,
+		uint32_t	dim)
+{
+	uint32_t k=0;
+
+	for (bmrm_ll* cp_ptr=head; cp_ptr!=NULL; cp_ptr=cp_ptr->next, ++k)
+	{
+		if (cp_ptr->idx==k)
+			continue;
+
+		/* slots are occupied in list order, hence k < idx and slot k is free */
+		ASSERT(map[k]);
+		LIBBMRM_MEMCPY(A+size_t(k)*dim, cp_ptr->address, dim*sizeof(float64_t));
+		map[cp_ptr->idx]=true;
+		map[k]=false;
+		cp_ptr->idx=k;
+		cp_ptr->address=A+size_t(k)*dim;
+	}
+}
+
+void cutting_plane_dots(
+		const float64_t*	A,
+		uint32_t			dim,
+		uint32_t			nCP,
+		const float64_t*	x,
+		float64_t*			result)
+{
+	Map<const MatrixXd> A_cp(A, dim, nCP);
+	Map<const VectorXd> x_vec(x, dim);
+	Map<VectorXd> r_vec(result, nCP);
+
+	r_vec.noalias()=A_cp.transpose()*x_vec;
+}
+
+void add_cutting_plane_combination(
+		const float64_t*	A,
+		uint32_t			dim,
+		uint32_t			nCP,
+		const float64_t*	beta,
+		float64_t			alpha,
+		float64_t*			result)
+{
+	Map<const MatrixXd> A_cp(A, dim, nCP);
+	Map<const VectorXd> beta_vec(beta, nCP);
+	Map<VectorXd> r_vec(result, dim);
+
+	r_vec.noalias()+=alpha*(A_cp*beta_vec);
+}
+
 void clean_icp(ICP_stats* icp_stats,
 		BmrmStatistics& bmrm,
 		bmrm_ll** head,
@@ -103,6 +339,8 @@ void clean_icp(ICP_stats* icp_stats,
 		uint32_t cleanAfter,
 		float64_t*& b,
 		uint32_t*& Ivector,
+		float64_t* A,
+		uint32_t dim,
 		uint32_t cp_models
 		)
 {
@@ -116,7 +354,7 @@ void clean_icp(ICP_stats* icp_stats,
 	{
 		if (icp_stats->ICPcounter[tmp_idx++]>=cleanAfter)
 		{
-			icp_stats->ICPs[cntICP++]=cp_ptr->address;
+			icp_stats->ICPs[cntICP++]=cp_ptr;
 		}
 		else
 		{
@@ -136,7 +374,7 @@ void clean_icp(ICP_stats* icp_stats,
 			tmp_idx=0;
 			cp_ptr=*head;
 
-			while(cp_ptr->address != icp_stats->ICPs[i])
+			while(cp_ptr != icp_stats->ICPs[i])
 			{
 				cp_ptr=cp_ptr->next;
 				tmp_idx++;
@@ -172,16 +410,11 @@ void clean_icp(ICP_stats* icp_stats,
 					icp_stats->H_buff[LIBBMRM_INDEX(i, j, icp_stats->maxCPs)];
 
 		bmrm.nCP=nCP_new;
-		ASSERT(bmrm.nCP<BufSize);
-	}
-}
+		ASSERT(bmrm.nCP<icp_stats->maxCPs);
 
-/*----------------------------------------------------------------------
-  Returns pointer at i-th column of Hessian matrix.
-  ----------------------------------------------------------------------*/
-static const float64_t *get_col( uint32_t i)
-{
-	return( &H[ BufSize*i ] );
+		if (A)
+			compact_cutting_planes(*head, map, A, dim);
+	}
 }
 
 BmrmStatistics svm_bmrm_solver(
@@ -195,13 +428,16 @@ BmrmStatistics svm_bmrm_solver(
 		uint32_t         cleanAfter,
 		float64_t        K,
 		uint32_t         Tmax,
-		bool             store_train_info)
+		bool             store_train_info,
+		uint32_t         num_threads,
+		bool             sparse_cps,
+		BmrmWarmStart*   warm_start)
 {
 	BmrmStatistics bmrm;
 	libqp_state_T qp_exitflag={0, 0, 0, 0};
-	float64_t *b, *beta, *diag_H;
+	float64_t *H, *b, *beta, *diag_H;
 	float64_t R, *A, QPSolverTolRel, C=1.0, wdist=0.0;
-	floatmax_t rsum, sq_norm_W, sq_norm_Wdiff=0.0;
+	floatmax_t sq_norm_W, sq_norm_Wdiff=0.0;
 	uint32_t *Ivector;
 	uint8_t S=1;
 	std::shared_ptr<StructuredModel> model=machine->get_model();
@@ -209,15 +445,20 @@ BmrmStatistics svm_bmrm_solver(
 	std::shared_ptr<SOSVMHelper> helper = NULL;
 
 	Time ttime;
-	float64_t tstart, tstop;
+	float64_t tstart, tstop, tphase;
 
 	bmrm_ll *CPList_head, *CPList_tail, *cp_ptr, *cp_ptr2, *cp_list=NULL;
 	bool *map=NULL;
+	uint32_t BufSize=_BufSize;
 
+	/* columns of H for the QP solver */
+	auto get_col=[&H, BufSize](uint32_t i) -> const float64_t*
+	{
+		return &H[(size_t)BufSize*i];
+	};
 
 	tstart=ttime.cur_time_diff(false);
 
-	BufSize=_BufSize;
 	QPSolverTolRel=1e-9;
 
 	uint32_t histSize = BufSize;
@@ -230,7 +471,10 @@ BmrmStatistics svm_bmrm_solver(
 
 	SGVector<float64_t> prevW(nDim), subgrad(nDim);
 
-	H= (float64_t*) LIBBMRM_CALLOC(BufSize*BufSize, float64_t);
+	/* sparse CP storage, used instead of A if sparse_cps is set */
+	std::vector<SGSparseVector<float64_t>> sparse_A(sparse_cps ? BufSize : 0);
+
+	H= (float64_t*) LIBBMRM_CALLOC(size_t(BufSize)*size_t(BufSize), float64_t);
 
 	if (H==NULL)
 	{
@@ -240,18 +484,22 @@ BmrmStatistics svm_bmrm_solver(
 
 	ASSERT(nDim > 0);
 	ASSERT(BufSize > 0);
-	require(BufSize < (std::numeric_limits<size_t>::max() / nDim),
-		"overflow: {} * {} > {} -- biggest possible BufSize={} or nDim={}",
-		BufSize, nDim, std::numeric_limits<size_t>::max(),
-		(std::numeric_limits<size_t>::max() / nDim),
-		(std::numeric_limits<size_t>::max() / BufSize));
 
-	A= (float64_t*) LIBBMRM_CALLOC(size_t(nDim)*size_t(BufSize), float64_t);
-
-	if (A==NULL)
+	if (!sparse_cps)
 	{
-		bmrm.exitflag=-2;
-		goto cleanup;
+		require(BufSize < (std::numeric_limits<size_t>::max() / nDim),
+			"overflow: {} * {} > {} -- biggest possible BufSize={} or nDim={}",
+			BufSize, nDim, std::numeric_limits<size_t>::max(),
+			(std::numeric_limits<size_t>::max() / nDim),
+			(std::numeric_limits<size_t>::max() / BufSize));
+
+		A= (float64_t*) LIBBMRM_CALLOC(size_t(nDim)*size_t(BufSize), float64_t);
+
+		if (A==NULL)
+		{
+			bmrm.exitflag=-2;
+			goto cleanup;
+		}
 	}
 
 	b= (float64_t*) LIBBMRM_CALLOC(BufSize, float64_t);
@@ -296,7 +544,7 @@ BmrmStatistics svm_bmrm_solver(
 		goto cleanup;
 	}
 
-	icp_stats.ICPs= (float64_t**) LIBBMRM_CALLOC(BufSize, float64_t*);
+	icp_stats.ICPs= (bmrm_ll**) LIBBMRM_CALLOC(BufSize, bmrm_ll*);
 	if (icp_stats.ICPs==NULL)
 	{
 		bmrm.exitflag=-2;
@@ -311,7 +559,7 @@ BmrmStatistics svm_bmrm_solver(
 	}
 
 	/* Temporary buffers for ICP removal */
-	icp_stats.H_buff= (float64_t*) LIBBMRM_CALLOC(BufSize*BufSize, float64_t);
+	icp_stats.H_buff= (float64_t*) LIBBMRM_CALLOC(size_t(BufSize)*size_t(BufSize), float64_t);
 	if (icp_stats.H_buff==NULL)
 	{
 		bmrm.exitflag=-2;
@@ -339,30 +587,154 @@ BmrmStatistics svm_bmrm_solver(
 	bmrm.hist_Fp = SGVector< float64_t >(histSize);
 	bmrm.hist_Fd = SGVector< float64_t >(histSize);
 	bmrm.hist_wdist = SGVector< float64_t >(histSize);
-
-	/* Iinitial solution */
-	R=machine->risk(subgrad, W);
+	bmrm.hist_time_risk = SGVector< float64_t >(histSize);
+	bmrm.hist_time_H = SGVector< float64_t >(histSize);
+	bmrm.hist_time_qp = SGVector< float64_t >(histSize);
+	bmrm.hist_time_W = SGVector< float64_t >(histSize);
+	bmrm.hist_time_cleanup = SGVector< float64_t >(histSize);
+	bmrm.hist_qp_iters = SGVector< uint32_t >(histSize);
+
+	bmrm.hist_time_H[0]=0.0;
+	bmrm.hist_time_qp[0]=0.0;
+	bmrm.hist_time_W[0]=0.0;
+	bmrm.hist_time_cleanup[0]=0.0;
+	bmrm.hist_qp_iters[0]=0;
 
 	bmrm.nCP=0;
 	bmrm.nIter=0;
 	bmrm.exitflag=0;
 
-	b[0]=-R;
+	if (warm_start!=NULL && warm_start->nCP>0)
+	{
+		bool usable=warm_start->nCP+1<BufSize;
 
-	/* Cutting plane auxiliary double linked list */
+		if (sparse_cps)
+			usable=usable && warm_start->sparse_A.size()==warm_start->nCP;
+		else
+			usable=usable && warm_start->A.num_rows==(index_t)nDim &&
+				warm_start->A.num_cols==(index_t)warm_start->nCP;
 
-	LIBBMRM_MEMCPY(A, subgrad.vector, nDim*sizeof(float64_t));
-	map[0]=false;
-	cp_list->address=&A[0];
-	cp_list->idx=0;
-	cp_list->prev=NULL;
-	cp_list->next=NULL;
-	CPList_head=cp_list;
-	CPList_tail=cp_list;
+		if (!usable)
+		{
+			io::warn("svm_bmrm_solver: kept cutting planes do not match "
+					"the current problem, starting from scratch");
+			warm_start->reset();
+		}
+	}
 
-	/* Compute initial value of Fp, Fd, assuming that W is zero vector */
+	if (warm_start!=NULL && warm_start->nCP>0)
+	{
+		/* Restore the kept CPs into the first slots of the CP buffer. Their
+		 * offsets do not depend on lambda and H is their Gram matrix scaled
+		 * by 1/lambda, so only H has to be rescaled. */
+		uint32_t nCP=warm_start->nCP;
+
+		if (sparse_cps)
+		{
+			sparse_A[0]=warm_start->sparse_A[0];
+			cp_list->address=NULL;
+		}
+		else
+		{
+			LIBBMRM_MEMCPY(A, warm_start->A.matrix, nDim*sizeof(float64_t));
+			cp_list->address=&A[0];
+		}
+
+		map[0]=false;
+		cp_list->idx=0;
+		cp_list->prev=NULL;
+		cp_list->next=NULL;
+		CPList_head=cp_list;
+		CPList_tail=cp_list;
+
+		for (uint32_t i=1; i<nCP; ++i)
+		{
+			if (sparse_cps)
+				add_sparse_cutting_plane(&CPList_tail, map, sparse_A.data(), i,
+						warm_start->sparse_A[i]);
+			else
+				add_cutting_plane(&CPList_tail, map, A, i, warm_start->A.get_column_vector(i), nDim);
+		}
+
+		for (uint32_t i=0; i<nCP; ++i)
+		{
+			for (uint32_t j=0; j<nCP; ++j)
+				H[LIBBMRM_INDEX(i, j, BufSize)]=warm_start->G(i, j)/_lambda;
+
+			diag_H[i]=H[LIBBMRM_INDEX(i, i, BufSize)];
+			b[i]=warm_start->b[i];
+			beta[i]=warm_start->beta[i];
+			Ivector[i]=1;
+		}
+
+		bmrm.nCP=nCP;
+
+		/* W corresponding to the kept solution of the reduced problem */
+		linalg::zero(W);
+
+		if (sparse_cps)
+		{
+			for (uint32_t j=0; j<nCP; ++j)
+			{
+				if (beta[j]!=0.0)
+					sparse_cutting_plane_axpy(-beta[j]/_lambda, sparse_A[j], W.vector);
+			}
+		}
+		else
+		{
+			add_cutting_plane_combination(A, nDim, nCP, beta, -1.0/_lambda, W.vector);
+		}
+
+		tphase=ttime.cur_time_diff(false);
+		R=bmrm_risk(machine, subgrad, W, NULL, num_threads);
+		bmrm.hist_time_risk[0]=ttime.cur_time_diff(false)-tphase;
+
+		if (sparse_cps)
+			add_sparse_cutting_plane(&CPList_tail, map, sparse_A.data(), nCP,
+					subgrad.vector, nDim);
+		else
+			add_cutting_plane(&CPList_tail, map, A, nCP, subgrad, nDim);
+
+		sq_norm_W=linalg::dot(W, W);
+		b[nCP]=linalg::dot(subgrad, W) - R;
+
+		io::info("svm_bmrm_solver: warm start from {} cutting planes", nCP);
+	}
+	else
+	{
+		/* Iinitial solution */
+		tphase=ttime.cur_time_diff(false);
+		R=bmrm_risk(machine, subgrad, W, NULL, num_threads);
+		bmrm.hist_time_risk[0]=ttime.cur_time_diff(false)-tphase;
+
+		b[0]=-R;
+
+		/* Cutting plane auxiliary double linked list */
+
+		if (sparse_cps)
+		{
+			sparse_A[0]=sparse_cutting_plane(subgrad.vector, nDim);
+			cp_list->address=NULL;
+		}
+		else
+		{
+			LIBBMRM_MEMCPY(A, subgrad.vector, nDim*sizeof(float64_t));
+			cp_list->address=&A[0];
+		}
+
+		map[0]=false;
+		cp_list->idx=0;
+		cp_list->prev=NULL;
+		cp_list->next=NULL;
+		CPList_head=cp_list;
+		CPList_tail=cp_list;
+
+		/* Initial value of Fp assumes that W is zero vector */
+		sq_norm_W=0;
+	}
+
+	/* Compute initial value of Fp, Fd */
 
-	sq_norm_W=0;
 	bmrm.Fp=R+0.5*_lambda*sq_norm_W;
 	bmrm.Fd=-LIBBMRM_PLUS_INF;
 
@@ -387,29 +759,49 @@ BmrmStatistics svm_bmrm_solver(
 		tstart=ttime.cur_time_diff(false);
 		bmrm.nIter++;
 
-		/* Update H */
+		// iteration exceeds histSize
+		if (bmrm.nIter >= histSize)
+		{
+			histSize += BufSize;
+			bmrm.hist_Fp.resize_vector(histSize);
+			bmrm.hist_Fd.resize_vector(histSize);
+			bmrm.hist_wdist.resize_vector(histSize);
+			bmrm.hist_time_risk.resize_vector(histSize);
+			bmrm.hist_time_H.resize_vector(histSize);
+			bmrm.hist_time_qp.resize_vector(histSize);
+			bmrm.hist_time_W.resize_vector(histSize);
+			bmrm.hist_time_cleanup.resize_vector(histSize);
+			bmrm.hist_qp_iters.resize_vector(histSize);
+		}
+
+		ASSERT(bmrm.nIter < histSize);
+
+		float64_t* H_col=&H[LIBBMRM_INDEX(0, bmrm.nCP, BufSize)];
 
-		if (bmrm.nCP>0)
+		if (sparse_cps)
 		{
-			SGVector<float64_t> A_2(get_cutting_plane(CPList_tail), nDim, false);
+			/* Update H: subgrad still holds the dense copy of the new CP */
 			cp_ptr=CPList_head;
 
-			for (uint32_t i=0; i<bmrm.nCP; ++i)
+			for (uint32_t i=0; i<=bmrm.nCP; ++i)
 			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
+				H_col[i]=sparse_cutting_plane_dot(sparse_A[cp_ptr->idx], subgrad.vector);
 				cp_ptr=cp_ptr->next;
-				rsum= linalg::dot(A_1, A_2);
-
-				H[LIBBMRM_INDEX(bmrm.nCP, i, BufSize)]
-					= H[LIBBMRM_INDEX(i, bmrm.nCP, BufSize)]
-					= rsum/_lambda;
 			}
 		}
+		else
+		{
+			/* Update H: the new CP is stored right after the nCP older ones,
+			 * so its column of H is a single matrix-vector product */
+			ASSERT(CPList_tail->idx==bmrm.nCP);
+			cutting_plane_dots(A, nDim, bmrm.nCP+1, get_cutting_plane(CPList_tail), H_col);
+		}
 
-		SGVector<float64_t> A_2(get_cutting_plane(CPList_tail), nDim, false);
-		rsum = linalg::dot(A_2, A_2);
+		for (uint32_t i=0; i<=bmrm.nCP; ++i)
+			H_col[i]/=_lambda;
 
-		H[LIBBMRM_INDEX(bmrm.nCP, bmrm.nCP, BufSize)]=rsum/_lambda;
+		for (uint32_t i=0; i<bmrm.nCP; ++i)
+			H[LIBBMRM_INDEX(bmrm.nCP, i, BufSize)]=H_col[i];
 
 		diag_H[bmrm.nCP]=H[LIBBMRM_INDEX(bmrm.nCP, bmrm.nCP, BufSize)];
 		Ivector[bmrm.nCP]=1;
@@ -418,6 +810,9 @@ BmrmStatistics svm_bmrm_solver(
 		bmrm.nCP++;
 		ASSERT(bmrm.nCP<BufSize);
 
+		tphase=ttime.cur_time_diff(false);
+		bmrm.hist_time_H[bmrm.nIter]=tphase-tstart;
+
 #if 0
 		/* TODO: scaling...*/
 		float64_t scale = Math::max(diag_H, BufSize)/(1000.0*_lambda);
@@ -430,15 +825,17 @@ BmrmStatistics svm_bmrm_solver(
 		sb.vec1_plus_scalar_times_vec2(sh.vector, 1/scale, diag_H, bmrm.nCP);
 
 		qp_exitflag =
-			libqp_splx_solver(&get_col, sh.vector, sb.vector, &C, I, &S, beta,
-				bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+			bmrm_splx_solver(get_col, sh.vector, sb.vector, &C, I, &S, beta,
+				bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 #else
 		/* call QP solver */
-		qp_exitflag=libqp_splx_solver(&get_col, diag_H, b, &C, Ivector, &S, beta,
-				bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+		qp_exitflag=bmrm_splx_solver(get_col, diag_H, b, &C, Ivector, &S, beta,
+				bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 #endif
 
 		bmrm.qp_exitflag=qp_exitflag.exitflag;
+		bmrm.hist_qp_iters[bmrm.nIter]=qp_exitflag.nIter;
+		bmrm.hist_time_qp[bmrm.nIter]=ttime.cur_time_diff(false)-tphase;
 
 		/* Update ICPcounter (add one to unused and reset used)
 		 * + compute number of active CPs */
@@ -458,19 +855,39 @@ BmrmStatistics svm_bmrm_solver(
 		}
 
 		/* W update */
+		tphase=ttime.cur_time_diff(false);
 		linalg::zero(W);
-		cp_ptr=CPList_head;
-		for (uint32_t j=0; j<bmrm.nCP; ++j)
+
+		if (sparse_cps)
+		{
+			cp_ptr=CPList_head;
+
+			for (uint32_t j=0; j<bmrm.nCP; ++j)
+			{
+				if (beta[j]!=0.0)
+					sparse_cutting_plane_axpy(-beta[j]/_lambda, sparse_A[cp_ptr->idx], W.vector);
+
+				cp_ptr=cp_ptr->next;
+			}
+		}
+		else
 		{
-			SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-			cp_ptr=cp_ptr->next;
-			SGVector<float64_t>::vec1_plus_scalar_times_vec2(W.vector, -beta[j]/_lambda, A_1.vector, nDim);
+			add_cutting_plane_combination(A, nDim, bmrm.nCP, beta, -1.0/_lambda, W.vector);
 		}
 
+		bmrm.hist_time_W[bmrm.nIter]=ttime.cur_time_diff(false)-tphase;
+
 		/* risk and subgradient computation */
-		R = machine->risk(subgrad, W);
-		add_cutting_plane(&CPList_tail, map, A,
-				find_free_idx(map, BufSize), subgrad, nDim);
+		tphase=ttime.cur_time_diff(false);
+		R = bmrm_risk(machine, subgrad, W, NULL, num_threads);
+		bmrm.hist_time_risk[bmrm.nIter]=ttime.cur_time_diff(false)-tphase;
+
+		if (sparse_cps)
+			add_sparse_cutting_plane(&CPList_tail, map, sparse_A.data(),
+					find_free_idx(map, BufSize), subgrad.vector, nDim);
+		else
+			add_cutting_plane(&CPList_tail, map, A,
+					find_free_idx(map, BufSize), subgrad, nDim);
 
 		sq_norm_W=linalg::dot(W, W);
 		b[bmrm.nCP]=linalg::dot(subgrad, W) - R;
@@ -499,17 +916,7 @@ BmrmStatistics svm_bmrm_solver(
 					bmrm.nIter, tstop-tstart, bmrm.Fp, bmrm.Fd, bmrm.Fp-bmrm.Fd,
 					(bmrm.Fp-bmrm.Fd)/bmrm.Fp, R, bmrm.nCP, bmrm.nzA, qp_exitflag.exitflag);
 
-		// iteration exceeds histSize
-		if (bmrm.nIter >= histSize)
-		{
-			histSize += BufSize;
-			bmrm.hist_Fp.resize_vector(histSize);
-			bmrm.hist_Fd.resize_vector(histSize);
-			bmrm.hist_wdist.resize_vector(histSize);
-		}
-
 		/* Keep Fp, Fd and w_dist history */
-		ASSERT(bmrm.nIter < histSize);
 		bmrm.hist_Fp[bmrm.nIter]=bmrm.Fp;
 		bmrm.hist_Fd[bmrm.nIter]=bmrm.Fd;
 		bmrm.hist_wdist[bmrm.nIter]=wdist;
@@ -518,12 +925,23 @@ BmrmStatistics svm_bmrm_solver(
 		LIBBMRM_MEMCPY(prevW.vector, W.vector, nDim*sizeof(float64_t));
 
 		/* Inactive Cutting Planes (ICP) removal */
+		tphase=ttime.cur_time_diff(false);
+
 		if (cleanICP)
 		{
-			clean_icp(&icp_stats, bmrm, &CPList_head, &CPList_tail, H, diag_H, beta, map, cleanAfter, b, Ivector);
+			clean_icp(&icp_stats, bmrm, &CPList_head, &CPList_tail, H, diag_H, beta, map, cleanAfter, b, Ivector, A, nDim);
+
+			/* release the sparse CPs that have been removed */
+			for (uint32_t i=0; i<sparse_A.size(); ++i)
+			{
+				if (map[i])
+					sparse_A[i]=SGSparseVector<float64_t>();
+			}
 			ASSERT(bmrm.nCP<BufSize);
 		}
 
+		bmrm.hist_time_cleanup[bmrm.nIter]=ttime.cur_time_diff(false)-tphase;
+
 		// next CP would exceed BufSize
 		if (bmrm.nCP+1 >= BufSize)
 			bmrm.exitflag=-1;
@@ -554,6 +972,53 @@ BmrmStatistics svm_bmrm_solver(
 	bmrm.hist_Fp.resize_vector(bmrm.nIter+1);
 	bmrm.hist_Fd.resize_vector(bmrm.nIter+1);
 	bmrm.hist_wdist.resize_vector(bmrm.nIter+1);
+	bmrm.hist_time_risk.resize_vector(bmrm.nIter+1);
+	bmrm.hist_time_H.resize_vector(bmrm.nIter+1);
+	bmrm.hist_time_qp.resize_vector(bmrm.nIter+1);
+	bmrm.hist_time_W.resize_vector(bmrm.nIter+1);
+	bmrm.hist_time_cleanup.resize_vector(bmrm.nIter+1);
+	bmrm.hist_qp_iters.resize_vector(bmrm.nIter+1);
+
+	/* Keep the CPs of the reduced problem for the next run. The last CP in
+	 * the list has no column in H yet and is left out. */
+	if (warm_start!=NULL)
+	{
+		uint32_t nCP=bmrm.nCP;
+
+		warm_start->reset();
+		warm_start->b=SGVector<float64_t>(nCP);
+		warm_start->beta=SGVector<float64_t>(nCP);
+		warm_start->G=SGMatrix<float64_t>(nCP, nCP);
+
+		if (sparse_cps)
+		{
+			warm_start->sparse_A.resize(nCP);
+			cp_ptr=CPList_head;
+
+			for (uint32_t i=0; i<nCP; ++i)
+			{
+				warm_start->sparse_A[i]=sparse_A[cp_ptr->idx];
+				cp_ptr=cp_ptr->next;
+			}
+		}
+		else
+		{
+			/* CPs are compacted in list order */
+			warm_start->A=SGMatrix<float64_t>(nDim, nCP);
+			LIBBMRM_MEMCPY(warm_start->A.matrix, A, size_t(nDim)*nCP*sizeof(float64_t));
+		}
+
+		for (uint32_t i=0; i<nCP; ++i)
+		{
+			for (uint32_t j=0; j<nCP; ++j)
+				warm_start->G(i, j)=H[LIBBMRM_INDEX(i, j, BufSize)]*_lambda;
+
+			warm_start->b[i]=b[i];
+			warm_start->beta[i]=beta[i];
+		}
+
+		warm_start->nCP=nCP;
+	}
 
 	cp_ptr=CPList_head;
 
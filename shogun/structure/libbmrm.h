@@ -18,22 +18,27 @@
 #ifdef USE_GPL_SHOGUN
 
 #include <shogun/lib/common.h>
+#include <shogun/lib/external/libqp.h>
+#include <shogun/lib/SGSparseVector.h>
 #include <shogun/structure/BmrmStatistics.h>
+#include <shogun/structure/BmrmWarmStart.h>
 #include <shogun/structure/DualLibQPBMSOSVM.h>
 
+#include <functional>
+
 #define LIBBMRM_PLUS_INF (-log(0.0))
 #define LIBBMRM_CALLOC(x, y) SG_CALLOC(y, x)
 #define LIBBMRM_REALLOC(x, y) SG_REALLOC(x, y)
 #define LIBBMRM_FREE(x) SG_FREE(x)
 #define LIBBMRM_MEMCPY(x, y, z) sg_memcpy(x, y, z)
 #define LIBBMRM_MEMMOVE(x, y, z) memmove(x, y, z)
-#define LIBBMRM_INDEX(ROW, COL, NUM_ROWS) ((COL)*(NUM_ROWS)+(ROW))
+#define LIBBMRM_INDEX(ROW, COL, NUM_ROWS) ((size_t)(COL)*(NUM_ROWS)+(ROW))
 #define LIBBMRM_ABS(A) ((A) < 0 ? -(A) : (A))
 
 namespace shogun
 {
-/** Buffer size */
-extern uint32_t BufSize;
+/** Column accessor of the Hessian passed to the inner QP solver */
+typedef std::function<const float64_t*(uint32_t)> bmrm_get_col_fn;
 
 /** Linked list for cutting planes buffer management */
 IGNORE_IN_CLASSLIST struct bmrm_ll {
@@ -41,7 +46,7 @@ IGNORE_IN_CLASSLIST struct bmrm_ll {
 	bmrm_ll   *prev;
 	/** Pointer to next CP entry */
 	bmrm_ll   *next;
-	/** Pointer to the real CP data */
+	/** Pointer to the real CP data, NULL if the CP is stored sparse */
 	float64_t   *address;
 	/** Index of CP */
 	uint32_t    idx;
@@ -56,8 +61,8 @@ IGNORE_IN_CLASSLIST struct ICP_stats
 	/** vector of the number of iterations the CPs were inactive */
 	uint32_t* ICPcounter;
 
-	/** vector of addresses of the inactive CPs that needs to be pruned */
-	float64_t** ICPs;
+	/** vector of the inactive CP entries that needs to be pruned */
+	bmrm_ll** ICPs;
 
 	/** vector of the active CPs */
 	uint32_t* ACPs;
@@ -83,21 +88,122 @@ void add_cutting_plane(
 		float64_t*	cp_data,
 		uint32_t	dim);
 
-/** Remove cutting plane at given index
+/** Add cutting plane in sparse representation
+ *
+ * Only the non-zero elements of cp_data are kept, the address of the
+ * new CP entry is NULL and the CP data are found at A[idx].
+ *
+ * @param tail Pointer to the last CP entry
+ * @param map Pointer to map storing info about CP physical memory
+ * @param A Sparse CP storage
+ * @param free_idx Index to the storage where the CP will be stored
+ * @param cp_data Dense CP data
+ * @param dim Dimension of CP data
+ */
+void add_sparse_cutting_plane(
+		bmrm_ll**	tail,
+		bool*		map,
+		SGSparseVector<float64_t>*	A,
+		uint32_t	free_idx,
+		const float64_t*	cp_data,
+		uint32_t	dim);
+
+/** Add cutting plane that is already in sparse representation
+ *
+ * @param tail Pointer to the last CP entry
+ * @param map Pointer to map storing info about CP physical memory
+ * @param A Sparse CP storage
+ * @param free_idx Index to the storage where the CP will be stored
+ * @param cp Sparse CP data
+ */
+void add_sparse_cutting_plane(
+		bmrm_ll**	tail,
+		bool*		map,
+		SGSparseVector<float64_t>*	A,
+		uint32_t	free_idx,
+		const SGSparseVector<float64_t>&	cp);
+
+/** Convert dense CP data to sparse representation
+ *
+ * @param cp_data Dense CP data
+ * @param dim Dimension of CP data
+ * @return Sparse vector holding the non-zero elements of cp_data
+ */
+SGSparseVector<float64_t> sparse_cutting_plane(
+		const float64_t*	cp_data,
+		uint32_t	dim);
+
+/** Remove cutting plane entry
  *
  * @param head Pointer to the first CP entry
  * @param tail Pointer to the last CP entry
  * @param map Pointer to map storing info about CP physical memory
- * @param icp Pointer to inactive CP that should be removed
+ * @param icp Inactive CP entry that should be removed
  */
 void remove_cutting_plane(
 		bmrm_ll**	head,
 		bmrm_ll**	tail,
 		bool*		map,
-		float64_t*	icp);
+		bmrm_ll*	icp);
+
+/** Move cutting planes to the front of the CP physical memory
+ *
+ * After the call the cutting planes occupy the first columns of A in the
+ * order of the list, which allows to process all of them by a single
+ * matrix-vector product (see cutting_plane_dots).
+ *
+ * @param head Pointer to the first CP entry
+ * @param map Pointer to map storing info about CP physical memory
+ * @param A CP physical memory
+ * @param dim Dimension of CP data
+ */
+void compact_cutting_planes(
+		bmrm_ll*	head,
+		bool*		map,
+		float64_t*	A,
+		uint32_t	dim);
+
+/** Compute dot products of the stored cutting planes with a vector
+ *
+ * The cutting planes have to be stored compactly in the first nCP
+ * columns of A, the products are computed as one matrix-vector product.
+ *
+ * @param A CP physical memory
+ * @param dim Dimension of CP data
+ * @param nCP Number of cutting planes
+ * @param x Vector of dimension dim
+ * @param result Array of nCP dot products (output)
+ */
+void cutting_plane_dots(
+		const float64_t*	A,
+		uint32_t			dim,
+		uint32_t			nCP,
+		const float64_t*	x,
+		float64_t*			result);
+
+/** Add a linear combination of the stored cutting planes to a vector,
+ * i.e. result += alpha*A*beta
+ *
+ * @param A CP physical memory
+ * @param dim Dimension of CP data
+ * @param nCP Number of cutting planes
+ * @param beta Coefficients of the cutting planes
+ * @param alpha Scaling factor
+ * @param result Vector of dimension dim (output)
+ */
+void add_cutting_plane_combination(
+		const float64_t*	A,
+		uint32_t			dim,
+		uint32_t			nCP,
+		const float64_t*	beta,
+		float64_t			alpha,
+		float64_t*			result);
 
 /**
  * Clean-up in-active cutting planes
+ *
+ * The remaining cutting planes are compacted in A (see
+ * compact_cutting_planes), A is NULL for sparse CP storage.
  */
 void clean_icp(ICP_stats* icp_stats,
 		BmrmStatistics& bmrm,
@@ -110,6 +216,8 @@ void clean_icp(ICP_stats* icp_stats,
 		uint32_t cleanAfter,
 		float64_t*& b,
 		uint32_t*& Ivector,
+		float64_t* A,
+		uint32_t dim,
 		uint32_t cp_models = 0
 		);
 
@@ -133,6 +241,53 @@ inline uint32_t find_free_idx(bool *map, uint32_t size)
     return size-1;
 }
 
+/** Solve the inner QP of the bundle methods with libqp_splx_solver
+ *
+ * libqp accepts only a plain function pointer as a column callback, so the
+ * given closure is bound to the calling thread for the duration of the call.
+ * This keeps the Hessian in the state of the calling solver and allows
+ * several solvers to run concurrently.
+ *
+ * @param get_col Closure returning pointer to the i-th column of H
+ * @see libqp_splx_solver for the remaining parameters
+ * @return libqp state of the finished QP solver
+ */
+libqp_state_T bmrm_splx_solver(
+		const bmrm_get_col_fn& get_col,
+		float64_t*	diag_H,
+		float64_t*	f,
+		float64_t*	b,
+		uint32_t*	I,
+		uint8_t*	S,
+		float64_t*	x,
+		uint32_t	n,
+		uint32_t	MaxIter,
+		float64_t	TolAbs,
+		float64_t	TolRel,
+		float64_t	QP_TH);
+
+/** Compute risk and subgradient with examples sharded across threads
+ *
+ * The examples of the given range are split into up to num_threads
+ * contiguous shards. Every shard is evaluated by machine->risk into its own
+ * subgradient accumulator, and the accumulators are summed by a pairwise
+ * tree reduction in a fixed order. With a single thread machine->risk is
+ * called directly, so the result is bit-identical to the serial solver.
+ *
+ * @param machine Pointer to the BMRM machine
+ * @param subgrad Subgradient of the risk at W (output)
+ * @param W Weight vector
+ * @param info Range of examples to be used, NULL for all examples
+ * @param num_threads Number of threads
+ * @return Value of the risk at W
+ */
+float64_t bmrm_risk(
+		DualLibQPBMSOSVM*		machine,
+		SGVector<float64_t>&	subgrad,
+		SGVector<float64_t>&	W,
+		TMultipleCPinfo*		info,
+		uint32_t				num_threads);
+
 /** Standard BMRM Solver for Structured Output Learning
  *
  * @param machine Pointer to the BMRM machine
@@ -146,6 +301,13 @@ inline uint32_t find_free_idx(bool *map, uint32_t size)
  * @param K Parameter K
  * @param Tmax Parameter Tmax
  * @param store_train_info Flag that enable/disable store training infomation, e.g., primal, dual, training error
+ * @param num_threads Number of threads used for the risk computation
+ * @param sparse_cps Flag that enables/disables storing the cutting planes as
+ * sparse vectors, which saves memory for subgradients with few non-zeros
+ * @param warm_start Cutting planes of a previous run. If it holds any, they
+ * are used to initialize the reduced problem instead of starting from
+ * a single cutting plane, and W is recomputed from the kept solution.
+ * On return it holds the cutting planes of this run. NULL disables it.
  * @return Structure with BMRM algorithm result
  */
 BmrmStatistics svm_bmrm_solver(
@@ -159,7 +321,10 @@ BmrmStatistics svm_bmrm_solver(
 		uint32_t           cleanAfter,
 		float64_t          K,
 		uint32_t           Tmax,
-		bool               store_train_info
+		bool               store_train_info,
+		uint32_t           num_threads=1,
+		bool               sparse_cps=false,
+		BmrmWarmStart*     warm_start=NULL
 		);
 
 }
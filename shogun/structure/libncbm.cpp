@@ -14,7 +14,6 @@
 #include <shogun/mathematics/Math.h>
 #include <shogun/mathematics/linalg/LinalgNamespace.h>
 
-#include <shogun/lib/external/libqp.h>
 #include <shogun/multiclass/GMNPLib.h>
 
 #include <vector>
@@ -22,15 +21,8 @@
 namespace shogun
 {
 
-static float64_t* HMatrix;
-static uint32_t maxCPs;
 static const float64_t epsilon=0.0;
 
-static const float64_t *get_col(uint32_t i)
-{
-	return (&HMatrix[maxCPs*i]);
-}
-
 IGNORE_IN_CLASSLIST struct line_search_res
 {
 	/* */
@@ -56,7 +48,8 @@ inline static line_search_res zoom
  float64_t f_lo,
  float64_t g_lo,
  float64_t f_hi,
- float64_t g_hi
+ float64_t g_hi,
+ uint32_t num_threads
 )
 {
 	line_search_res ls_res;
@@ -93,7 +86,7 @@ inline static line_search_res zoom
 				initial_solution.vector, a_j,
 				search_dir.vector, cur_solution.vlen);
 
-		float64_t cur_fval = machine->risk(cur_grad, cur_solution);
+		float64_t cur_fval = bmrm_risk(machine, cur_grad, cur_solution, NULL, num_threads);
 		float64_t cur_reg
 			= 0.5*lambda*linalg::dot(cur_solution, cur_solution);
 		cur_fval += cur_reg;
@@ -165,6 +158,7 @@ inline std::vector<line_search_res> line_search_with_strong_wolfe
 		SGVector<float64_t>& initial_grad,
 		SGVector<float64_t>& search_dir,
 		float64_t astart,
+		uint32_t num_threads,
 		float64_t amax = 1.1,
 		float64_t wolfe_c1 = 1E-4,
 		float64_t wolfe_c2 = 0.9,
@@ -197,7 +191,7 @@ inline std::vector<line_search_res> line_search_with_strong_wolfe
 		SGVector<float64_t> cur_subgrad(initial_solution.vlen);
 
 		x.add(x.vector, 1.0, initial_solution.vector, cur_a, search_dir.vector, x.vlen);
-		float64_t cur_fval = machine->risk(cur_subgrad, x);
+		float64_t cur_fval = bmrm_risk(machine, cur_subgrad, x, NULL, num_threads);
 		float64_t cur_reg = 0.5*lambda*linalg::dot(x, x);
 		cur_fval += cur_reg;
 
@@ -224,7 +218,8 @@ inline std::vector<line_search_res> line_search_with_strong_wolfe
 			ret.push_back(
 					zoom(machine, lambda, prev_a, cur_a, initial_val,
 						initial_solution, search_dir, wolfe_c1, wolfe_c2,
-						initial_lgrad, prev_fval, prev_lgrad, cur_fval, cur_lgrad)
+						initial_lgrad, prev_fval, prev_lgrad, cur_fval, cur_lgrad,
+						num_threads)
 					);
 			return ret;
 		}
@@ -246,7 +241,8 @@ inline std::vector<line_search_res> line_search_with_strong_wolfe
 			ret.push_back(
 					zoom(machine, lambda, cur_a, prev_a, initial_val,
 						initial_solution, search_dir, wolfe_c1, wolfe_c2,
-						initial_lgrad, cur_fval, cur_lgrad, prev_fval, prev_lgrad)
+						initial_lgrad, cur_fval, cur_lgrad, prev_fval, prev_lgrad,
+						num_threads)
 					);
 			return ret;
 		}
@@ -272,32 +268,25 @@ inline std::vector<line_search_res> line_search_with_strong_wolfe
 }
 
 inline void update_H(BmrmStatistics& ncbm,
-		bmrm_ll* head,
 		bmrm_ll* tail,
+		SGMatrix<float64_t>& A,
 		SGMatrix<float64_t>& H,
 		SGVector<float64_t>& diag_H,
 		float64_t lambda,
 		uint32_t maxCP,
 		int32_t w_dim)
 {
-	SGVector<float64_t> a_2(get_cutting_plane(tail), w_dim, false);
-	bmrm_ll* cp_ptr=head;
-
-	for (uint32_t i=0; i < ncbm.nCP; ++i)
-	{
-		SGVector<float64_t> a_1(get_cutting_plane(cp_ptr), w_dim, false);
-		cp_ptr=cp_ptr->next;
-
-		float64_t dot_val = linalg::dot(a_2, a_1);
+	/* the new CP is stored right after the nCP older ones, so its column
+	 * of H (including the diagonal element) is a single matrix-vector product */
+	ASSERT(tail->idx==ncbm.nCP);
+	float64_t* H_col=&H.matrix[LIBBMRM_INDEX(0, ncbm.nCP, maxCP)];
+	cutting_plane_dots(A.matrix, w_dim, ncbm.nCP+1, get_cutting_plane(tail), H_col);
 
-		H.matrix[LIBBMRM_INDEX(ncbm.nCP, i, maxCP)]
-			= H.matrix[LIBBMRM_INDEX(i, ncbm.nCP, maxCP)]
-			= dot_val/lambda;
-	}
+	for (uint32_t i=0; i <= ncbm.nCP; ++i)
+		H_col[i]/=lambda;
 
-	/* set the diagonal element, i.e. subgrad_i*subgrad_i' */
-	float64_t dot_val = linalg::dot(a_2, a_2);
-	H[LIBBMRM_INDEX(ncbm.nCP, ncbm.nCP, maxCP)]=dot_val/lambda;
+	for (uint32_t i=0; i < ncbm.nCP; ++i)
+		H.matrix[LIBBMRM_INDEX(ncbm.nCP, i, maxCP)]=H_col[i];
 
 	diag_H[ncbm.nCP]=H[LIBBMRM_INDEX(ncbm.nCP, ncbm.nCP, maxCP)];
 
@@ -316,7 +305,8 @@ BmrmStatistics svm_ncbm_solver(
 		uint32_t          cleanAfter,
 		bool              is_convex,
 		bool              line_search,
-		bool              verbose
+		bool              verbose,
+		uint32_t          num_threads
 		)
 {
 	BmrmStatistics ncbm;
@@ -325,8 +315,7 @@ BmrmStatistics svm_ncbm_solver(
 	auto model = machine->get_model();
 	int32_t w_dim = model->get_dim();
 
-	maxCPs = _BufSize;
-	BufSize = _BufSize;
+	uint32_t maxCPs = _BufSize;
 
 	ncbm.nCP=0;
 	ncbm.nIter=0;
@@ -346,7 +335,12 @@ BmrmStatistics svm_ncbm_solver(
 
 	/* Matrix for storing H = A*A' */
 	SGMatrix<float64_t> H(maxCPs,maxCPs);
-	HMatrix = H.matrix;
+
+	/* columns of H for the QP solver */
+	auto get_col=[&H, maxCPs](uint32_t i) -> const float64_t*
+	{
+		return &H.matrix[maxCPs*i];
+	};
 
 	/* diag_H */
 	SGVector<float64_t> diag_H(maxCPs);
@@ -374,7 +368,7 @@ BmrmStatistics svm_ncbm_solver(
 	ICP_stats icp_stats;
 	icp_stats.maxCPs = maxCPs;
 	icp_stats.ICPcounter = (uint32_t*) LIBBMRM_CALLOC(maxCPs, uint32_t);
-	icp_stats.ICPs = (float64_t**) LIBBMRM_CALLOC(maxCPs, float64_t*);
+	icp_stats.ICPs = (bmrm_ll**) LIBBMRM_CALLOC(maxCPs, bmrm_ll*);
 	icp_stats.ACPs = (uint32_t*) LIBBMRM_CALLOC(maxCPs, uint32_t);
 	icp_stats.H_buff = (float64_t*) LIBBMRM_CALLOC(maxCPs*maxCPs,float64_t);
 	if
@@ -404,7 +398,7 @@ BmrmStatistics svm_ncbm_solver(
 	SGVector<float64_t> cur_w(w_dim);
 	sg_memcpy(cur_w.vector, w, sizeof(float64_t)*w_dim);
 
-	float64_t cur_risk = machine->risk(cur_subgrad, cur_w);
+	float64_t cur_risk = bmrm_risk(machine, cur_subgrad, cur_w, NULL, num_threads);
 	bias[0] = -cur_risk;
 	best_Fp = 0.5*_lambda*linalg::dot(cur_w, cur_w) + cur_risk;
 	best_risk = cur_risk;
@@ -429,7 +423,7 @@ BmrmStatistics svm_ncbm_solver(
 	CPList_head=cp_list;
 	CPList_tail=cp_list;
 
-	update_H(ncbm, CPList_head, CPList_tail, H, diag_H, _lambda, maxCPs, w_dim);
+	update_H(ncbm, CPList_tail, A, H, diag_H, _lambda, maxCPs, w_dim);
 	tstop=ttime.cur_time_diff(false);
 	if (verbose)
 		io::print("{:4d}: tim={:.3f}, Fp={}, Fd={}, R={}\n",
@@ -450,8 +444,8 @@ BmrmStatistics svm_ncbm_solver(
 		 *
 		 */
 		qp_exitflag =
-			libqp_splx_solver(&get_col, diag_H.vector, bias.vector, &b, Ivector.vector, &S, x.vector,
-					ncbm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+			bmrm_splx_solver(get_col, diag_H.vector, bias.vector, &b, Ivector.vector, &S, x.vector,
+					ncbm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 
 		ncbm.Fd = -qp_exitflag.QP;
 
@@ -480,20 +474,15 @@ BmrmStatistics svm_ncbm_solver(
 		{
 			clean_icp(&icp_stats, ncbm, &CPList_head, &CPList_tail,
 					H.matrix, diag_H.vector, x.vector,
-					map.vector, cleanAfter, bias.vector, Ivector.vector);
+					map.vector, cleanAfter, bias.vector, Ivector.vector,
+					A.matrix, w_dim);
 		}
 
 		/* calculate the new w
 		 * w[i] = -1/lambda*A[i]*x[i]
 		 */
 		cur_w.zero();
-		cp_ptr=CPList_head;
-		for (uint32_t i=0; i < ncbm.nCP; ++i)
-		{
-			float64_t* A_1 = get_cutting_plane(cp_ptr);
-			cp_ptr=cp_ptr->next;
-			SGVector<float64_t>::vec1_plus_scalar_times_vec2(cur_w.vector, -x[i]/_lambda, A_1, w_dim);
-		}
+		add_cutting_plane_combination(A.matrix, w_dim, ncbm.nCP, x.vector, -1.0/_lambda, cur_w.vector);
 
 		bool calc_gap = false;
 		if (calc_gap)
@@ -544,14 +533,14 @@ BmrmStatistics svm_ncbm_solver(
 		std::vector<line_search_res> wbest_candidates;
 		if (!line_search)
 		{
-			cur_risk = machine->risk(cur_subgrad, cur_w);
+			cur_risk = bmrm_risk(machine, cur_subgrad, cur_w, NULL, num_threads);
 
 			add_cutting_plane(&CPList_tail, map, A.matrix,
 					find_free_idx(map, maxCPs), cur_subgrad.vector, w_dim);
 
 			bias[ncbm.nCP] = linalg::dot(cur_w, cur_subgrad) - cur_risk;
 
-			update_H(ncbm, CPList_head, CPList_tail, H, diag_H, _lambda, maxCPs, w_dim);
+			update_H(ncbm, CPList_tail, A, H, diag_H, _lambda, maxCPs, w_dim);
 
 			// add as a new wbest candidate
 			line_search_res ls;
@@ -584,7 +573,7 @@ BmrmStatistics svm_ncbm_solver(
 
 			/* line search */
 			std::vector<line_search_res> ls_res
-				= line_search_with_strong_wolfe(machine, _lambda, best_Fp, best_w, best_subgrad, search_dir, astart);
+				= line_search_with_strong_wolfe(machine, _lambda, best_Fp, best_w, best_subgrad, search_dir, astart, num_threads);
 
 			if (ls_res[0].fval != ls_res[1].fval)
 			{
@@ -597,7 +586,7 @@ BmrmStatistics svm_ncbm_solver(
 					= linalg::dot(ls_res[0].solution, ls_res[0].gradient)
 					- (ls_res[0].fval - ls_res[0].reg);
 
-				update_H(ncbm, CPList_head, CPList_tail, H, diag_H, _lambda, maxCPs, w_dim);
+				update_H(ncbm, CPList_tail, A, H, diag_H, _lambda, maxCPs, w_dim);
 
 				wbest_candidates.push_back(ls_res[0]);
 			}
@@ -611,20 +600,20 @@ BmrmStatistics svm_ncbm_solver(
 				= linalg::dot(ls_res[1].solution, ls_res[1].gradient)
 				- (ls_res[1].fval - ls_res[1].reg);
 
-			update_H(ncbm, CPList_head, CPList_tail, H, diag_H, _lambda, maxCPs, w_dim);
+			update_H(ncbm, CPList_tail, A, H, diag_H, _lambda, maxCPs, w_dim);
 
 			wbest_candidates.push_back(ls_res[1]);
 
 			if ((best_Fp <= ls_res[1].fval) && (astart != 1))
 			{
-				cur_risk = machine->risk(cur_subgrad, cur_w);
+				cur_risk = bmrm_risk(machine, cur_subgrad, cur_w, NULL, num_threads);
 
 				add_cutting_plane(&CPList_tail, map, A.matrix,
 							find_free_idx(map, maxCPs), cur_subgrad.vector, w_dim);
 
 				bias[ncbm.nCP] = linalg::dot(cur_w, cur_subgrad) - cur_risk;
 
-				update_H(ncbm, CPList_head, CPList_tail, H, diag_H, _lambda, maxCPs, w_dim);
+				update_H(ncbm, CPList_tail, A, H, diag_H, _lambda, maxCPs, w_dim);
 
 				/* add as a new wbest candidate */
 				line_search_res ls;
@@ -739,7 +728,8 @@ BmrmStatistics svm_ncbm_solver(
 		{
 			clean_icp(&icp_stats, ncbm, &CPList_head, &CPList_tail,
 					H.matrix, diag_H.vector, x.vector,
-					map.vector, cleanAfter, bias.vector, I.vector);
+					map.vector, cleanAfter, bias.vector, I.vector,
+					A.matrix, w_dim);
 		}
 		*/
 	}
@@ -25,6 +25,8 @@ namespace shogun
 	 * Solves any unconstrainedminimization problem in the form of:
 	 * min lambda/2 ||w||^2 + R(w)
 	 * where R(w) is a risk funciton of any kind.
+	 *
+	 * The risk is computed with up to num_threads threads, see bmrm_risk.
 	 */
 	BmrmStatistics svm_ncbm_solver(
 			DualLibQPBMSOSVM  *machine,
@@ -37,7 +39,8 @@ namespace shogun
 			uint32_t         cleanAfter,
 			bool             is_convex = false,
 			bool             line_search = true,
-			bool             verbose = false
+			bool             verbose = false,
+			uint32_t         num_threads = 1
 			);
 }
 #endif //USE_GPL_SHOGUN
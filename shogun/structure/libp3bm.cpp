@@ -13,7 +13,6 @@
 
 #include <shogun/structure/libp3bm.h>
 #ifdef USE_GPL_SHOGUN
-#include <shogun/lib/external/libqp.h>
 #include <shogun/lib/Time.h>
 #include <shogun/mathematics/Math.h>
 #include <shogun/mathematics/linalg/LinalgNamespace.h>
@@ -25,14 +24,33 @@ namespace shogun
 static const uint32_t QPSolverMaxIter=0xFFFFFFFF;
 static const float64_t epsilon=0.0;
 
-static float64_t *H, *H2;
-
 /*----------------------------------------------------------------------
-  Returns pointer at i-th column of Hessian matrix.
+  Computes risk and subgradient of all cutting plane models. The slices
+  of the training set are independent, each one has its own subgradient
+  buffer and is evaluated by one of up to num_threads threads. If there
+  are fewer slices than threads, the examples of every slice are sharded
+  across the threads instead.
   ----------------------------------------------------------------------*/
-static const float64_t *get_col( uint32_t i)
+static void risk_cp_models(
+		DualLibQPBMSOSVM *machine,
+		SGVector<float64_t>& W,
+		std::vector<SGVector<float64_t>>& subgrad_t,
+		float64_t *Rt,
+		TMultipleCPinfo **info,
+		uint32_t cp_models,
+		uint32_t num_threads)
 {
-	return( &H2[ BufSize*i ] );
+	if (cp_models<num_threads)
+	{
+		for (uint32_t p=0; p<cp_models; ++p)
+			Rt[p]=bmrm_risk(machine, subgrad_t[p], W, info[p], num_threads);
+
+		return;
+	}
+
+	#pragma omp parallel for schedule(dynamic) num_threads(num_threads) if (num_threads>1)
+	for (int32_t p=0; p<(int32_t)cp_models; ++p)
+		Rt[p]=machine->risk(subgrad_t[p], W, info[p]);
 }
 
 BmrmStatistics svm_p3bm_solver(
@@ -47,15 +65,16 @@ BmrmStatistics svm_p3bm_solver(
 		float64_t       K,
 		uint32_t        Tmax,
 		uint32_t        cp_models,
-		bool            verbose)
+		bool            verbose,
+		uint32_t        num_threads)
 {
 	BmrmStatistics p3bmrm;
 	libqp_state_T qp_exitflag={0, 0, 0, 0}, qp_exitflag_good={0, 0, 0, 0};
-	float64_t *b, *b2, *beta, *beta_good, *beta_start, *diag_H, *diag_H2;
+	float64_t *H, *H2, *b, *b2, *beta, *beta_good, *beta_start, *diag_H, *diag_H2;
 	float64_t R, *Rt, *A, QPSolverTolRel, *C=NULL;
 	float64_t *wt, alpha, alpha_start, alpha_good=0.0, Fd_alpha0=0.0;
 	float64_t lastFp, wdist, gamma=0.0;
-	floatmax_t rsum, sq_norm_W, sq_norm_Wdiff, sq_norm_prevW, eps;
+	floatmax_t sq_norm_W, sq_norm_Wdiff, sq_norm_prevW, eps;
 	uint32_t *Ivector, *I2, *I_start, *I_good;
 	uint8_t *S=NULL;
 	uint32_t qp_cnt=0;
@@ -67,6 +86,13 @@ BmrmStatistics svm_p3bm_solver(
 	std::shared_ptr<SOSVMHelper> helper = NULL;
 	uint32_t nDim=model->get_dim();
 	uint32_t to=0, N=0, cp_i=0;
+	uint32_t BufSize=_BufSize*cp_models;
+
+	/* columns of H2 for the QP solver */
+	auto get_col=[&H2, BufSize](uint32_t i) -> const float64_t*
+	{
+		return &H2[BufSize*i];
+	};
 
 	Time ttime;
 	float64_t tstart, tstop;
@@ -74,7 +100,6 @@ BmrmStatistics svm_p3bm_solver(
 
 	tstart=ttime.cur_time_diff(false);
 
-	BufSize=_BufSize*cp_models;
 	QPSolverTolRel=1e-9;
 
 	H=NULL;
@@ -115,6 +140,9 @@ BmrmStatistics svm_p3bm_solver(
 
 	SGVector<float64_t> prevW(nDim);
 
+	/* dot products of the cutting planes with prevW */
+	SGVector<float64_t> A_prevW(BufSize);
+
 	wt= (float64_t*) LIBBMRM_CALLOC(nDim, float64_t);
 
 	C= (float64_t*) LIBBMRM_CALLOC(cp_models, float64_t);
@@ -130,7 +158,7 @@ BmrmStatistics svm_p3bm_solver(
 	ICP_stats icp_stats;
 	icp_stats.maxCPs = BufSize;
 	icp_stats.ICPcounter= (uint32_t*) LIBBMRM_CALLOC(BufSize, uint32_t);
-	icp_stats.ICPs= (float64_t**) LIBBMRM_CALLOC(BufSize, float64_t*);
+	icp_stats.ICPs= (bmrm_ll**) LIBBMRM_CALLOC(BufSize, bmrm_ll*);
 	icp_stats.ACPs= (uint32_t*) LIBBMRM_CALLOC(BufSize, uint32_t);
 	icp_stats.H_buff= (float64_t*) LIBBMRM_CALLOC(BufSize*BufSize, float64_t);
 
@@ -206,7 +234,7 @@ BmrmStatistics svm_p3bm_solver(
 	p3bmrm.hist_wdist.resize_vector(BufSize);
 
 	/* Iinitial solution */
-	Rt[0] = machine->risk(subgrad_t[0], W, info[0]);
+	risk_cp_models(machine, W, subgrad_t, Rt, info, cp_models, num_threads);
 
 	p3bmrm.nCP=0;
 	p3bmrm.nIter=0;
@@ -226,7 +254,6 @@ BmrmStatistics svm_p3bm_solver(
 
 	for (uint32_t p=1; p<cp_models; ++p)
 	{
-		Rt[p] = machine->risk(subgrad_t[p], W, info[p]);
 		b[p]=linalg::dot(subgrad_t[p], W) - Rt[p];
 		add_cutting_plane(&CPList_tail, map, A, find_free_idx(map, BufSize), subgrad_t[p].vector, nDim);
 	}
@@ -277,47 +304,15 @@ BmrmStatistics svm_p3bm_solver(
 		tstart=ttime.cur_time_diff(false);
 		p3bmrm.nIter++;
 
-		/* Update H */
-		if (p3bmrm.nIter==1)
+		/* Update H: the new CPs are stored right after the nCP older ones,
+		 * so each of their columns of H is a single matrix-vector product */
+		for (uint32_t p=0; p<cp_models; ++p)
 		{
-			cp_ptr=CPList_head;
+			float64_t* H_col=&H[LIBBMRM_INDEX(0, p3bmrm.nCP+p, BufSize)];
+			cutting_plane_dots(A, nDim, p3bmrm.nCP+cp_models, subgrad_t[p].vector, H_col);
 
-			for (cp_i=0; cp_i<cp_models; ++cp_i)  /* for all cutting planes */
-			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-
-				for (uint32_t p=0; p<cp_models; ++p)
-				{
-					rsum=linalg::dot(A_1, subgrad_t[p]);
-
-					H[LIBBMRM_INDEX(p, cp_i, BufSize)]=rsum;
-				}
-
-				cp_ptr=cp_ptr->next;
-			}
-		}
-		else
-		{
-			cp_ptr=CPList_head;
-
-			for (cp_i=0; cp_i<p3bmrm.nCP+cp_models; ++cp_i)  /* for all cutting planes */
-			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-
-				for (uint32_t p=0; p<cp_models; ++p)
-				{
-					rsum=linalg::dot(A_1, subgrad_t[p]);
-
-					H[LIBBMRM_INDEX(p3bmrm.nCP+p, cp_i, BufSize)]=rsum;
-				}
-
-				cp_ptr=cp_ptr->next;
-			}
-
-			for (uint32_t i=0; i<p3bmrm.nCP; ++i)
-				for (uint32_t j=0; j<cp_models; ++j)
-					H[LIBBMRM_INDEX(i, p3bmrm.nCP+j, BufSize)]=
-						H[LIBBMRM_INDEX(p3bmrm.nCP+j, i, BufSize)];
+			for (cp_i=0; cp_i<p3bmrm.nCP; ++cp_i)
+				H[LIBBMRM_INDEX(p3bmrm.nCP+p, cp_i, BufSize)]=H_col[cp_i];
 		}
 
 		for (uint32_t p=0; p<cp_models; ++p)
@@ -325,6 +320,9 @@ BmrmStatistics svm_p3bm_solver(
 
 		p3bmrm.nCP+=cp_models;
 
+		/* dot products of all CPs with prevW used by the alpha-dependent terms */
+		cutting_plane_dots(A, nDim, p3bmrm.nCP, prevW.vector, A_prevW.vector);
+
 		/* tune alpha cycle */
 		/* ------------------------------------------------------------------------ */
 		flag=true;
@@ -346,16 +344,9 @@ BmrmStatistics svm_p3bm_solver(
 			LIBBMRM_MEMCPY(I2, I_start, p3bmrm.nCP*sizeof(uint32_t));
 
 			/* add alpha-dependent terms to H, diag_h and b */
-			cp_ptr=CPList_head;
-
 			for (uint32_t i=0; i<p3bmrm.nCP; ++i)
 			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-
-				rsum = linalg::dot(A_1, prevW);
-
-				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*rsum;
+				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*A_prevW[i];
 				diag_H2[i]=diag_H[i]/(_lambda+2*alpha);
 
 				for (uint32_t j=0; j<p3bmrm.nCP; ++j)
@@ -365,8 +356,8 @@ BmrmStatistics svm_p3bm_solver(
 			}
 
 			/* solve QP with current alpha */
-			qp_exitflag=libqp_splx_solver(&get_col, diag_H2, b2, C, I2, S, beta,
-					p3bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+			qp_exitflag=bmrm_splx_solver(get_col, diag_H2, b2, C, I2, S, beta,
+					p3bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 			p3bmrm.qp_exitflag=qp_exitflag.exitflag;
 			qp_cnt++;
 			Fd_alpha0=-qp_exitflag.QP;
@@ -374,13 +365,7 @@ BmrmStatistics svm_p3bm_solver(
 			/* obtain w_t and check if norm(w_{t+1} -w_t) <= K */
 			memset(wt, 0, sizeof(float64_t)*nDim);
 			SGVector<float64_t>::vec1_plus_scalar_times_vec2(wt, 2*alpha/(_lambda+2*alpha), prevW.vector, nDim);
-			cp_ptr=CPList_head;
-			for (uint32_t j=0; j<p3bmrm.nCP; ++j)
-			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-				SGVector<float64_t>::vec1_plus_scalar_times_vec2(wt, -beta[j]/(_lambda+2*alpha), A_1.vector, nDim);
-			}
+			add_cutting_plane_combination(A, nDim, p3bmrm.nCP, beta, -1.0/(_lambda+2*alpha), wt);
 
 			sq_norm_Wdiff=0.0;
 
@@ -405,16 +390,9 @@ BmrmStatistics svm_p3bm_solver(
 				LIBBMRM_MEMCPY(beta, beta_start, p3bmrm.nCP*sizeof(float64_t));
 
 				/* add alpha-dependent terms to H, diag_h and b */
-				cp_ptr=CPList_head;
-
 				for (uint32_t i=0; i<p3bmrm.nCP; ++i)
 				{
-					SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-					cp_ptr=cp_ptr->next;
-
-					rsum = linalg::dot(A_1, prevW);
-
-					b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*rsum;
+					b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*A_prevW[i];
 					diag_H2[i]=diag_H[i]/(_lambda+2*alpha);
 
 					for (uint32_t j=0; j<p3bmrm.nCP; ++j)
@@ -422,21 +400,15 @@ BmrmStatistics svm_p3bm_solver(
 				}
 
 				/* solve QP with current alpha */
-				qp_exitflag=libqp_splx_solver(&get_col, diag_H2, b2, C, I2, S, beta,
-						p3bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+				qp_exitflag=bmrm_splx_solver(get_col, diag_H2, b2, C, I2, S, beta,
+						p3bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 				p3bmrm.qp_exitflag=qp_exitflag.exitflag;
 				qp_cnt++;
 
 				/* obtain w_t and check if norm(w_{t+1}-w_t) <= K */
 				memset(wt, 0, sizeof(float64_t)*nDim);
 				SGVector<float64_t>::vec1_plus_scalar_times_vec2(wt, 2*alpha/(_lambda+2*alpha), prevW.vector, nDim);
-				cp_ptr=CPList_head;
-				for (uint32_t j=0; j<p3bmrm.nCP; ++j)
-				{
-					SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-					cp_ptr=cp_ptr->next;
-					SGVector<float64_t>::vec1_plus_scalar_times_vec2(wt, -beta[j]/(_lambda+2*alpha), A_1.vector, nDim);
-				}
+				add_cutting_plane_combination(A, nDim, p3bmrm.nCP, beta, -1.0/(_lambda+2*alpha), wt);
 
 				sq_norm_Wdiff=0.0;
 
@@ -505,16 +477,9 @@ BmrmStatistics svm_p3bm_solver(
 			LIBBMRM_MEMCPY(beta, beta_start, p3bmrm.nCP*sizeof(float64_t));
 
 			/* add alpha-dependent terms to H, diag_h and b */
-			cp_ptr=CPList_head;
-
 			for (uint32_t i=0; i<p3bmrm.nCP; ++i)
 			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-
-				rsum = linalg::dot(A_1, prevW);
-
-				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*rsum;
+				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*A_prevW[i];
 				diag_H2[i]=diag_H[i]/(_lambda+2*alpha);
 
 				for (uint32_t j=0; j<p3bmrm.nCP; ++j)
@@ -522,8 +487,8 @@ BmrmStatistics svm_p3bm_solver(
 			}
 
 			/* solve QP with current alpha */
-			qp_exitflag=libqp_splx_solver(&get_col, diag_H2, b2, C, I2, S, beta,
-					p3bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+			qp_exitflag=bmrm_splx_solver(get_col, diag_H2, b2, C, I2, S, beta,
+					p3bmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 			p3bmrm.qp_exitflag=qp_exitflag.exitflag;
 			qp_cnt++;
 		}
@@ -548,20 +513,15 @@ BmrmStatistics svm_p3bm_solver(
 		/* W update */
 		linalg::zero(W);
 		SGVector<float64_t>::vec1_plus_scalar_times_vec2(W.vector, 2*alpha/(_lambda+2*alpha), prevW.vector, nDim);
-		cp_ptr=CPList_head;
-		for (uint32_t j=0; j<p3bmrm.nCP; ++j)
-		{
-			SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-			cp_ptr=cp_ptr->next;
-			SGVector<float64_t>::vec1_plus_scalar_times_vec2(W.vector, -beta[j]/(_lambda+2*alpha), A_1.vector, nDim);
-		}
+		add_cutting_plane_combination(A, nDim, p3bmrm.nCP, beta, -1.0/(_lambda+2*alpha), W.vector);
 
 		/* risk and subgradient computation */
 		R=0.0;
+		risk_cp_models(machine, W, subgrad_t, Rt, info, cp_models, num_threads);
 
+		/* reduce in the order of the models to keep the result deterministic */
 		for (uint32_t p=0; p<cp_models; ++p)
 		{
-			Rt[p] = machine->risk(subgrad_t[p], W, info[p]);
 			b[p3bmrm.nCP+p] = linalg::dot(subgrad_t[p], W) - Rt[p];
 			add_cutting_plane(&CPList_tail, map, A, find_free_idx(map, BufSize), subgrad_t[p].vector, nDim);
 			R+=Rt[p];
@@ -649,7 +609,7 @@ BmrmStatistics svm_p3bm_solver(
 		{
 			clean_icp(&icp_stats, p3bmrm, &CPList_head,
 					&CPList_tail, H, diag_H, beta, map,
-					cleanAfter, b, Ivector, cp_models);
+					cleanAfter, b, Ivector, A, nDim, cp_models);
 		}
 
 		// next CP would exceed BufSize
@@ -39,6 +39,10 @@ namespace shogun
 	 * @param Tmax			Parameter Tmax
 	 * @param cp_models		Count of cutting plane models to be used
 	 * @param verbose		Flag that enables/disables screen output
+	 * @param num_threads	Number of threads used for the risk computation,
+	 *						the cutting plane models are evaluated concurrently
+	 *						if there are at least as many models as threads,
+	 *						otherwise the examples of each model are sharded
 	 * @return Structure with BMRM algorithm result
 	 */
 	BmrmStatistics svm_p3bm_solver(
@@ -53,7 +57,8 @@ namespace shogun
 			float64_t	K,
 			uint32_t	Tmax,
 			uint32_t        cp_models,
-			bool	verbose
+			bool	verbose,
+			uint32_t	num_threads=1
 			);
 
 }
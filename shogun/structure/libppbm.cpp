@@ -13,7 +13,6 @@
 
 #include <shogun/structure/libppbm.h>
 #ifdef USE_GPL_SHOGUN
-#include <shogun/lib/external/libqp.h>
 #include <shogun/mathematics/Math.h>
 #include <shogun/mathematics/linalg/LinalgNamespace.h>
 #include <shogun/lib/Time.h>
@@ -23,16 +22,6 @@ namespace shogun
 static const uint32_t QPSolverMaxIter=0xFFFFFFFF;
 static const float64_t epsilon=0.0;
 
-static float64_t *H, *H2;
-
-/*----------------------------------------------------------------------
-  Returns pointer at i-th column of Hessian matrix.
-  ----------------------------------------------------------------------*/
-static const float64_t *get_col( uint32_t i)
-{
-	return( &H2[ BufSize*i ] );
-}
-
 BmrmStatistics svm_ppbm_solver(
 		DualLibQPBMSOSVM *machine,
 		SGVector<float64_t>& W,
@@ -44,15 +33,16 @@ BmrmStatistics svm_ppbm_solver(
 		uint32_t        cleanAfter,
 		float64_t       K,
 		uint32_t        Tmax,
-		bool            verbose)
+		bool            verbose,
+		uint32_t        num_threads)
 {
 	BmrmStatistics ppbmrm;
 	libqp_state_T qp_exitflag={0, 0, 0, 0}, qp_exitflag_good={0, 0, 0, 0};
-	float64_t *b, *b2, *beta, *beta_good, *beta_start, *diag_H, *diag_H2;
+	float64_t *H, *H2, *b, *b2, *beta, *beta_good, *beta_start, *diag_H, *diag_H2;
 	float64_t R, *A, QPSolverTolRel, C=1.0;
 	float64_t *wt, alpha, alpha_start, alpha_good=0.0, Fd_alpha0=0.0;
 	float64_t lastFp, wdist, gamma=0.0;
-	floatmax_t rsum, sq_norm_W, sq_norm_Wdiff, sq_norm_prevW, eps;
+	floatmax_t sq_norm_W, sq_norm_Wdiff, sq_norm_prevW, eps;
 	uint32_t *Ivector, *I2, *I_start, *I_good;
 	uint8_t S=1;
 	auto model=machine->get_model();
@@ -61,6 +51,13 @@ BmrmStatistics svm_ppbm_solver(
 	uint32_t qp_cnt=0;
 	bmrm_ll *CPList_head, *CPList_tail, *cp_ptr, *cp_ptr2, *cp_list=NULL;
 	bool *map=NULL, tuneAlpha=true, flag=true, alphaChanged=false, isThereGoodSolution=false;
+	uint32_t BufSize=_BufSize;
+
+	/* columns of H2 for the QP solver */
+	auto get_col=[&H2, BufSize](uint32_t i) -> const float64_t*
+	{
+		return &H2[BufSize*i];
+	};
 
 	Time ttime;
 	float64_t tstart, tstop;
@@ -68,7 +65,6 @@ BmrmStatistics svm_ppbm_solver(
 
 	tstart=ttime.cur_time_diff(false);
 
-	BufSize=_BufSize;
 	QPSolverTolRel=1e-9;
 
 	H=NULL;
@@ -115,13 +111,16 @@ BmrmStatistics svm_ppbm_solver(
 	ICP_stats icp_stats;
 	icp_stats.maxCPs = BufSize;
 	icp_stats.ICPcounter= (uint32_t*) LIBBMRM_CALLOC(BufSize, uint32_t);
-	icp_stats.ICPs= (float64_t**) LIBBMRM_CALLOC(BufSize, float64_t*);
+	icp_stats.ICPs= (bmrm_ll**) LIBBMRM_CALLOC(BufSize, bmrm_ll*);
 	icp_stats.ACPs= (uint32_t*) LIBBMRM_CALLOC(BufSize, uint32_t);
 
 	cp_list= (bmrm_ll*) LIBBMRM_CALLOC(1, bmrm_ll);
 
 	SGVector<float64_t> prevW(nDim);
 
+	/* dot products of the cutting planes with prevW */
+	SGVector<float64_t> A_prevW(BufSize);
+
 	wt= (float64_t*) LIBBMRM_CALLOC(nDim, float64_t);
 
 	if (H==NULL || A==NULL || b==NULL || beta==NULL ||
@@ -181,7 +180,7 @@ BmrmStatistics svm_ppbm_solver(
 	ppbmrm.hist_wdist.resize_vector(BufSize);
 
 	/* Iinitial solution */
-	R = machine->risk(subgrad, W);
+	R = bmrm_risk(machine, subgrad, W, NULL, num_threads);
 
 	ppbmrm.nCP=0;
 	ppbmrm.nIter=0;
@@ -241,29 +240,14 @@ BmrmStatistics svm_ppbm_solver(
 		tstart=ttime.cur_time_diff(false);
 		ppbmrm.nIter++;
 
-		/* Update H */
+		/* Update H: the new CP is stored right after the nCP older ones,
+		 * so its column of H is a single matrix-vector product */
+		ASSERT(CPList_tail->idx==ppbmrm.nCP);
+		float64_t* H_col=&H[LIBBMRM_INDEX(0, ppbmrm.nCP, BufSize)];
+		cutting_plane_dots(A, nDim, ppbmrm.nCP+1, get_cutting_plane(CPList_tail), H_col);
 
-		if (ppbmrm.nCP>0)
-		{
-			SGVector<float64_t> A_2(get_cutting_plane(CPList_tail), nDim, false);
-			cp_ptr=CPList_head;
-
-			for (uint32_t i=0; i<ppbmrm.nCP; ++i)
-			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-				rsum=linalg::dot(A_1, A_2);
-
-				H[LIBBMRM_INDEX(ppbmrm.nCP, i, BufSize)]
-					= H[LIBBMRM_INDEX(i, ppbmrm.nCP, BufSize)]
-					= rsum;
-			}
-		}
-
-		SGVector<float64_t> A_2(get_cutting_plane(CPList_tail), nDim, false);
-		rsum = linalg::dot(A_2, A_2);
-
-		H[LIBBMRM_INDEX(ppbmrm.nCP, ppbmrm.nCP, BufSize)]=rsum;
+		for (uint32_t i=0; i<ppbmrm.nCP; ++i)
+			H[LIBBMRM_INDEX(ppbmrm.nCP, i, BufSize)]=H_col[i];
 
 		diag_H[ppbmrm.nCP]=H[LIBBMRM_INDEX(ppbmrm.nCP, ppbmrm.nCP, BufSize)];
 		Ivector[ppbmrm.nCP]=1;
@@ -271,6 +255,9 @@ BmrmStatistics svm_ppbm_solver(
 		beta[ppbmrm.nCP]=0.0; // [beta; 0]
 		ppbmrm.nCP++;
 
+		/* dot products of all CPs with prevW used by the alpha-dependent terms */
+		cutting_plane_dots(A, nDim, ppbmrm.nCP, prevW.vector, A_prevW.vector);
+
 		/* tune alpha cycle */
 		/* ---------------------------------------------------------------------- */
 
@@ -289,16 +276,9 @@ BmrmStatistics svm_ppbm_solver(
 			I2[ppbmrm.nCP]=1;
 
 			/* add alpha-dependent terms to H, diag_h and b */
-			cp_ptr=CPList_head;
-
 			for (uint32_t i=0; i<ppbmrm.nCP; ++i)
 			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-
-				rsum = linalg::dot(A_1, prevW);
-
-				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*rsum;
+				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*A_prevW[i];
 				diag_H2[i]=diag_H[i]/(_lambda+2*alpha);
 
 				for (uint32_t j=0; j<ppbmrm.nCP; ++j)
@@ -307,27 +287,18 @@ BmrmStatistics svm_ppbm_solver(
 			}
 
 			/* solve QP with current alpha */
-			qp_exitflag=libqp_splx_solver(&get_col, diag_H2, b2, &C, I2, &S, beta,
-					ppbmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+			qp_exitflag=bmrm_splx_solver(get_col, diag_H2, b2, &C, I2, &S, beta,
+					ppbmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 			ppbmrm.qp_exitflag=qp_exitflag.exitflag;
 			qp_cnt++;
 			Fd_alpha0=-qp_exitflag.QP;
 
 			/* obtain w_t and check if norm(w_{t+1} -w_t) <= K */
-			for (uint32_t i=0; i<nDim; ++i)
-			{
-				rsum=0.0;
-				cp_ptr=CPList_head;
+			memset(wt, 0, sizeof(float64_t)*nDim);
+			add_cutting_plane_combination(A, nDim, ppbmrm.nCP, beta, -1.0, wt);
 
-				for (uint32_t j=0; j<ppbmrm.nCP; ++j)
-				{
-					SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-					cp_ptr=cp_ptr->next;
-					rsum+=A_1[i]*beta[j];
-				}
-
-				wt[i]=(2*alpha*prevW[i] - rsum)/(_lambda+2*alpha);
-			}
+			for (uint32_t i=0; i<nDim; ++i)
+				wt[i]=(2*alpha*prevW[i]+wt[i])/(_lambda+2*alpha);
 
 			sq_norm_Wdiff=0.0;
 
@@ -354,16 +325,9 @@ BmrmStatistics svm_ppbm_solver(
 				beta[ppbmrm.nCP]=0.0;
 
 				/* add alpha-dependent terms to H, diag_h and b */
-				cp_ptr=CPList_head;
-
 				for (uint32_t i=0; i<ppbmrm.nCP; ++i)
 				{
-					SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-					cp_ptr=cp_ptr->next;
-
-					rsum = linalg::dot(A_1, prevW);
-
-					b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*rsum;
+					b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*A_prevW[i];
 					diag_H2[i]=diag_H[i]/(_lambda+2*alpha);
 
 					for (uint32_t j=0; j<ppbmrm.nCP; ++j)
@@ -371,26 +335,17 @@ BmrmStatistics svm_ppbm_solver(
 				}
 
 				/* solve QP with current alpha */
-				qp_exitflag=libqp_splx_solver(&get_col, diag_H2, b2, &C, I2, &S, beta,
-						ppbmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+				qp_exitflag=bmrm_splx_solver(get_col, diag_H2, b2, &C, I2, &S, beta,
+						ppbmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 				ppbmrm.qp_exitflag=qp_exitflag.exitflag;
 				qp_cnt++;
 
 				/* obtain w_t and check if norm(w_{t+1}-w_t) <= K */
-				for (uint32_t i=0; i<nDim; ++i)
-				{
-					rsum=0.0;
-					cp_ptr=CPList_head;
-
-					for (uint32_t j=0; j<ppbmrm.nCP; ++j)
-					{
-						SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-						cp_ptr=cp_ptr->next;
-						rsum+=A_1[i]*beta[j];
-					}
+				memset(wt, 0, sizeof(float64_t)*nDim);
+				add_cutting_plane_combination(A, nDim, ppbmrm.nCP, beta, -1.0, wt);
 
-					wt[i]=(2*alpha*prevW[i] - rsum)/(_lambda+2*alpha);
-				}
+				for (uint32_t i=0; i<nDim; ++i)
+					wt[i]=(2*alpha*prevW[i]+wt[i])/(_lambda+2*alpha);
 
 				sq_norm_Wdiff=0.0;
 				for (uint32_t i=0; i<nDim; ++i)
@@ -459,16 +414,9 @@ BmrmStatistics svm_ppbm_solver(
 			LIBBMRM_MEMCPY(beta, beta_start, ppbmrm.nCP*sizeof(float64_t));
 
 			/* add alpha-dependent terms to H, diag_h and b */
-			cp_ptr=CPList_head;
-
 			for (uint32_t i=0; i<ppbmrm.nCP; ++i)
 			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-
-				rsum = linalg::dot(A_1, prevW);
-
-				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*rsum;
+				b2[i]=b[i]-((2*alpha)/(_lambda+2*alpha))*A_prevW[i];
 				diag_H2[i]=diag_H[i]/(_lambda+2*alpha);
 
 				for (uint32_t j=0; j<ppbmrm.nCP; ++j)
@@ -476,8 +424,8 @@ BmrmStatistics svm_ppbm_solver(
 						H[LIBBMRM_INDEX(i, j, BufSize)]/(_lambda+2*alpha);
 			}
 			/* solve QP with current alpha */
-			qp_exitflag=libqp_splx_solver(&get_col, diag_H2, b2, &C, I2, &S, beta,
-					ppbmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF, 0);
+			qp_exitflag=bmrm_splx_solver(get_col, diag_H2, b2, &C, I2, &S, beta,
+					ppbmrm.nCP, QPSolverMaxIter, 0.0, QPSolverTolRel, -LIBBMRM_PLUS_INF);
 			ppbmrm.qp_exitflag=qp_exitflag.exitflag;
 			qp_cnt++;
 		}
@@ -501,23 +449,14 @@ BmrmStatistics svm_ppbm_solver(
 		}
 
 		/* W update */
-		for (uint32_t i=0; i<nDim; ++i)
-		{
-			rsum=0.0;
-			cp_ptr=CPList_head;
-
-			for (uint32_t j=0; j<ppbmrm.nCP; ++j)
-			{
-				SGVector<float64_t> A_1(get_cutting_plane(cp_ptr), nDim, false);
-				cp_ptr=cp_ptr->next;
-				rsum+=A_1[i]*beta[j];
-			}
+		memset(W.vector, 0, sizeof(float64_t)*nDim);
+		add_cutting_plane_combination(A, nDim, ppbmrm.nCP, beta, -1.0, W.vector);
 
-			W[i]=(2*alpha*prevW[i]-rsum)/(_lambda+2*alpha);
-		}
+		for (uint32_t i=0; i<nDim; ++i)
+			W[i]=(2*alpha*prevW[i]+W[i])/(_lambda+2*alpha);
 
 		/* risk and subgradient computation */
-		R = machine->risk(subgrad, W);
+		R = bmrm_risk(machine, subgrad, W, NULL, num_threads);
 		add_cutting_plane(&CPList_tail, map, A,
 				find_free_idx(map, BufSize), subgrad.vector, nDim);
 
@@ -602,7 +541,7 @@ BmrmStatistics svm_ppbm_solver(
 		/* Inactive Cutting Planes (ICP) removal */
 		if (cleanICP)
 		{
-			clean_icp(&icp_stats, ppbmrm, &CPList_head, &CPList_tail, H, diag_H, beta, map, cleanAfter, b, Ivector);
+			clean_icp(&icp_stats, ppbmrm, &CPList_head, &CPList_tail, H, diag_H, beta, map, cleanAfter, b, Ivector, A, nDim);
 		}
 
 		// next CP would exceed BufSize
@@ -37,6 +37,7 @@ namespace shogun
 	 * @param K				Parameter K
 	 * @param Tmax			Parameter Tmax
 	 * @param verbose		Flag that enables/disables screen output
+	 * @param num_threads	Number of threads used for the risk computation
 	 * @return Structure with BMRM algorithm result
 	 */
 	BmrmStatistics svm_ppbm_solver(
@@ -50,7 +51,8 @@ namespace shogun
 			uint32_t	cleanAfter,
 			float64_t	K,
 			uint32_t	Tmax,
-			bool	verbose
+			bool	verbose,
+			uint32_t	num_threads=1
 			);
 
 }
@@ -70,6 +70,9 @@ MultitaskClusteredLogisticRegression::~MultitaskClusteredLogisticRegression()
 bool MultitaskClusteredLogisticRegression::train_locked_implementation(const std::shared_ptr<Features>& data, 
 			const std::shared_ptr<Labels>& labs, SGVector<index_t>* tasks)
 {
+	require(m_path_size == 1, "{} does not support regularization paths", get_name());
+	m_path_w.clear();
+	m_path_c.clear();
 	SGVector<float64_t> y(labs->get_num_labels());
 	auto bl = binary_labels(labs);
 	const auto features = data->as<DotFeatures>();
@@ -80,6 +83,7 @@ bool MultitaskClusteredLogisticRegression::train_locked_implementation(const std
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.n_tasks = m_task_relation->as<TaskGroup>()->get_num_tasks();
 	options.tasks_indices = tasks;
 	options.n_clusters = m_num_clusters;
@@ -96,6 +100,9 @@ bool MultitaskClusteredLogisticRegression::train_locked_implementation(const std
 bool MultitaskClusteredLogisticRegression::train_machine(const std::shared_ptr<DotFeatures>& features,
 	const std::shared_ptr<Labels>& labs)
 {
+	require(m_path_size == 1, "{} does not support regularization paths", get_name());
+	m_path_w.clear();
+	m_path_c.clear();
 	require(m_task_relation, "Task relation not set");
 	SGVector<float64_t> y(labs->get_num_labels());
 	auto bl = binary_labels(labs);
@@ -106,6 +113,7 @@ bool MultitaskClusteredLogisticRegression::train_machine(const std::shared_ptr<D
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.n_tasks = m_task_relation->as<TaskGroup>()->get_num_tasks();
 	options.tasks_indices = m_task_relation->as<TaskGroup>()->get_tasks_indices();
 	options.n_clusters = m_num_clusters;
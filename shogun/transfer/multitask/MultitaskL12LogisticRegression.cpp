@@ -81,6 +81,9 @@ MultitaskL12LogisticRegression::~MultitaskL12LogisticRegression()
 bool MultitaskL12LogisticRegression::train_locked_implementation(const std::shared_ptr<Features>& data, 
 			const std::shared_ptr<Labels>& labs, SGVector<index_t>* tasks)
 {
+	require(m_path_size == 1, "{} does not support regularization paths", get_name());
+	m_path_w.clear();
+	m_path_c.clear();
 	SGVector<float64_t> y(labs->get_num_labels());
 	auto bl = binary_labels(labs);
 	const auto features = data->as<DotFeatures>();
@@ -91,6 +94,7 @@ bool MultitaskL12LogisticRegression::train_locked_implementation(const std::shar
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.n_tasks = m_task_relation->as<TaskGroup>()->get_num_tasks();
 	options.tasks_indices = tasks;
 	malsar_result_t model = malsar_joint_feature_learning(
@@ -105,6 +109,9 @@ bool MultitaskL12LogisticRegression::train_locked_implementation(const std::shar
 bool MultitaskL12LogisticRegression::train_machine(const std::shared_ptr<DotFeatures>& features,
 			const std::shared_ptr<Labels>& labs)
 {
+	require(m_path_size == 1, "{} does not support regularization paths", get_name());
+	m_path_w.clear();
+	m_path_c.clear();
 	SGVector<float64_t> y(labs->get_num_labels());
 	auto bl = binary_labels(labs);
 	for (int32_t i=0; i<y.vlen; i++)
@@ -114,6 +121,7 @@ bool MultitaskL12LogisticRegression::train_machine(const std::shared_ptr<DotFeat
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.n_tasks = m_task_relation->as<TaskGroup>()->get_num_tasks();
 	options.tasks_indices = m_task_relation->as<TaskGroup>()->get_tasks_indices();
 
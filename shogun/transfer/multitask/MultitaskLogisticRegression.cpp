@@ -46,6 +46,9 @@ void MultitaskLogisticRegression::register_parameters()
 	SG_ADD(&m_regularization, "regularization", "regularization");
 	SG_ADD(&m_tolerance, "tolerance", "tolerance");
 	SG_ADD(&m_max_iter, "max_iter", "maximum number of iterations");
+	SG_ADD(&m_num_threads, "num_threads", "number of threads");
+	SG_ADD(&m_path_size, "path_size", "number of regularization path values");
+	SG_ADD(&m_path_ratio, "path_ratio", "ratio of the smallest and the largest z of the path");
 }
 
 void MultitaskLogisticRegression::initialize_parameters()
@@ -56,6 +59,9 @@ void MultitaskLogisticRegression::initialize_parameters()
 	set_regularization(0);
 	set_tolerance(1e-3);
 	set_max_iter(1000);
+	set_num_threads(1);
+	set_path_size(1);
+	set_path_ratio(0.01);
 }
 
 bool MultitaskLogisticRegression::train_machine(const std::shared_ptr<DotFeatures>& features,
@@ -74,7 +80,9 @@ bool MultitaskLogisticRegression::train_machine(const std::shared_ptr<DotFeature
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 
+	SGVector<float64_t> ind_t;
 	ETaskRelationType relation_type = m_task_relation->get_relation_type();
 	switch (relation_type)
 	{
@@ -83,27 +91,40 @@ bool MultitaskLogisticRegression::train_machine(const std::shared_ptr<DotFeature
 			//TaskGroup* task_group = (TaskGroup*)m_task_relation;
 			options.mode = MULTITASK_GROUP;
 			options.loss = LOGISTIC;
-			slep_result_t result = slep_solver(features, y.vector, m_z, options);
-			m_tasks_w = result.w;
-			m_tasks_c = result.c;
 		}
 		break;
 		case TASK_TREE:
 		{
 			auto task_tree = m_task_relation->as<TaskTree>();
-			SGVector<float64_t> ind_t = task_tree->get_SLEP_ind_t();
+			ind_t = task_tree->get_SLEP_ind_t();
 			options.ind_t = ind_t.vector;
 			options.n_nodes = ind_t.vlen / 3;
 			options.mode = MULTITASK_TREE;
 			options.loss = LOGISTIC;
-			slep_result_t result = slep_solver(features, y.vector, m_z, options);
-			m_tasks_w = result.w;
-			m_tasks_c = result.c;
 		}
 		break;
 		default:
 			error("Not supported task relation type");
 	}
+
+	m_path_w.clear();
+	m_path_c.clear();
+	if (m_path_size>1)
+	{
+		std::vector<slep_result_t> path = slep_solver_path(features, y.vector, get_path_z(), options);
+		for (const auto& result : path)
+		{
+			m_path_w.push_back(result.w);
+			m_path_c.push_back(result.c);
+		}
+		select_path_solution(m_path_size-1);
+	}
+	else
+	{
+		slep_result_t result = slep_solver(features, y.vector, m_z, options);
+		m_tasks_w = result.w;
+		m_tasks_c = result.c;
+	}
 	SG_FREE(options.tasks_indices);
 
 	return true;
@@ -127,7 +148,9 @@ bool MultitaskLogisticRegression::train_locked_implementation(const std::shared_
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 
+	SGVector<float64_t> ind_t;
 	ETaskRelationType relation_type = m_task_relation->get_relation_type();
 	switch (relation_type)
 	{
@@ -136,27 +159,40 @@ bool MultitaskLogisticRegression::train_locked_implementation(const std::shared_
 			//TaskGroup* task_group = (TaskGroup*)m_task_relation;
 			options.mode = MULTITASK_GROUP;
 			options.loss = LOGISTIC;
-			slep_result_t result = slep_solver(features, y.vector, m_z, options);
-			m_tasks_w = result.w;
-			m_tasks_c = result.c;
 		}
 		break;
 		case TASK_TREE:
 		{
 			auto task_tree = m_task_relation->as<TaskTree>();
-			SGVector<float64_t> ind_t = task_tree->get_SLEP_ind_t();
+			ind_t = task_tree->get_SLEP_ind_t();
 			options.ind_t = ind_t.vector;
 			options.n_nodes = ind_t.vlen / 3;
 			options.mode = MULTITASK_TREE;
 			options.loss = LOGISTIC;
-			slep_result_t result = slep_solver(features, y.vector, m_z, options);
-			m_tasks_w = result.w;
-			m_tasks_c = result.c;
 		}
 		break;
 		default:
 			error("Not supported task relation type");
 	}
+
+	m_path_w.clear();
+	m_path_c.clear();
+	if (m_path_size>1)
+	{
+		std::vector<slep_result_t> path = slep_solver_path(features, y.vector, get_path_z(), options);
+		for (const auto& result : path)
+		{
+			m_path_w.push_back(result.w);
+			m_path_c.push_back(result.c);
+		}
+		select_path_solution(m_path_size-1);
+	}
+	else
+	{
+		slep_result_t result = slep_solver(features, y.vector, m_z, options);
+		m_tasks_w = result.w;
+		m_tasks_c = result.c;
+	}
 	return true;
 }
 
@@ -192,6 +228,22 @@ float64_t MultitaskLogisticRegression::get_q() const
 {
 	return m_q;
 }
+int32_t MultitaskLogisticRegression::get_num_threads() const
+{
+	return m_num_threads;
+}
+int32_t MultitaskLogisticRegression::get_path_size() const
+{
+	return m_path_size;
+}
+float64_t MultitaskLogisticRegression::get_path_ratio() const
+{
+	return m_path_ratio;
+}
+SGVector<float64_t> MultitaskLogisticRegression::get_path_z() const
+{
+	return slep_z_path(m_z, m_path_ratio, m_path_size);
+}
 
 void MultitaskLogisticRegression::set_max_iter(int32_t max_iter)
 {
@@ -221,6 +273,27 @@ void MultitaskLogisticRegression::set_q(float64_t q)
 {
 	m_q = q;
 }
+void MultitaskLogisticRegression::set_num_threads(int32_t num_threads)
+{
+	require(num_threads > 0, "Number of threads must be positive");
+	m_num_threads = num_threads;
+}
+void MultitaskLogisticRegression::set_path_size(int32_t path_size)
+{
+	ASSERT(path_size>0)
+	m_path_size = path_size;
+}
+void MultitaskLogisticRegression::set_path_ratio(float64_t path_ratio)
+{
+	ASSERT(path_ratio>0.0 && path_ratio<=1.0)
+	m_path_ratio = path_ratio;
+}
+void MultitaskLogisticRegression::select_path_solution(int32_t i)
+{
+	require(i>=0 && i<(int32_t)m_path_w.size(), "Path solution {} is not available", i);
+	m_tasks_w = m_path_w[i];
+	m_tasks_c = m_path_c[i];
+}
 
 }
 
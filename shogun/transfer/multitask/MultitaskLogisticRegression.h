@@ -19,6 +19,8 @@
 #include <shogun/transfer/multitask/TaskTree.h>
 #include <shogun/transfer/multitask/Task.h>
 
+#include <vector>
+
 
 namespace shogun
 {
@@ -71,6 +73,16 @@ class MultitaskLogisticRegression : public MultitaskLinearMachine
 		float64_t get_tolerance() const;
 		/** get z */
 		float64_t get_z() const;
+		/** get number of threads */
+		int32_t get_num_threads() const;
+		/** get path size */
+		int32_t get_path_size() const;
+		/** get path ratio */
+		float64_t get_path_ratio() const;
+		/** get values of z on the regularization path, a geometric
+		 * sequence from z down to z*path_ratio
+		 */
+		SGVector<float64_t> get_path_z() const;
 
 		/** set max iter */
 		void set_max_iter(int32_t max_iter);
@@ -84,6 +96,21 @@ class MultitaskLogisticRegression : public MultitaskLinearMachine
 		void set_tolerance(float64_t tolerance);
 		/** set z */
 		void set_z(float64_t z);
+		/** set number of threads used to evaluate the loss and its gradient */
+		void set_num_threads(int32_t num_threads);
+		/** set number of values of z on the regularization path,
+		 * training with more than one value solves the problem for
+		 * each of them, starting each solve from the previous solution
+		 * and discarding groups by the sequential strong rule, and
+		 * keeps the solution for the smallest z. Both train() and the
+		 * locked training of this class follow the path, the L12, trace
+		 * norm and clustered subclasses reject a path size above 1.
+		 */
+		void set_path_size(int32_t path_size);
+		/** set ratio of the smallest and the largest z of the path */
+		void set_path_ratio(float64_t path_ratio);
+		/** use the solution for the i-th value of get_path_z() */
+		void select_path_solution(int32_t i);
 
 		/** applies to one vector */
 		virtual float64_t apply_one(const std::shared_ptr<DotFeatures>& features, int32_t i);
@@ -126,6 +153,21 @@ class MultitaskLogisticRegression : public MultitaskLinearMachine
 		/** regularization coefficient */
 		float64_t m_z;
 
+		/** number of threads */
+		int32_t m_num_threads;
+
+		/** number of regularization path values */
+		int32_t m_path_size;
+
+		/** ratio of the smallest and the largest z of the path */
+		float64_t m_path_ratio;
+
+		/** task weights along the regularization path */
+		std::vector<SGMatrix<float64_t>> m_path_w;
+
+		/** task biases along the regularization path */
+		std::vector<SGVector<float64_t>> m_path_c;
+
 };
 }
 #endif //USE_GPL_SHOGUN
@@ -57,6 +57,9 @@ MultitaskTraceLogisticRegression::~MultitaskTraceLogisticRegression()
 bool MultitaskTraceLogisticRegression::train_locked_implementation(const std::shared_ptr<Features>& data, 
 			const std::shared_ptr<Labels>& labs,SGVector<index_t>* tasks)
 {
+	require(m_path_size == 1, "{} does not support regularization paths", get_name());
+	m_path_w.clear();
+	m_path_c.clear();
 	SGVector<float64_t> y(labs->get_num_labels());
 	auto bl = binary_labels(labs);
 	for (int32_t i=0; i<y.vlen; i++)
@@ -66,6 +69,7 @@ bool MultitaskTraceLogisticRegression::train_locked_implementation(const std::sh
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.n_tasks = m_task_relation->as<TaskGroup>()->get_num_tasks();
 	options.tasks_indices = tasks;
 
@@ -80,6 +84,9 @@ bool MultitaskTraceLogisticRegression::train_locked_implementation(const std::sh
 bool MultitaskTraceLogisticRegression::train_machine(const std::shared_ptr<DotFeatures>& features, 
 			const std::shared_ptr<Labels>& labs)
 {
+	require(m_path_size == 1, "{} does not support regularization paths", get_name());
+	m_path_w.clear();
+	m_path_c.clear();
 	SGVector<float64_t> y(labs->get_num_labels());
 	auto bl = binary_labels(labs);
 	for (int32_t i=0; i<y.vlen; i++)
@@ -89,6 +96,7 @@ bool MultitaskTraceLogisticRegression::train_machine(const std::shared_ptr<DotFe
 	options.termination = m_termination;
 	options.tolerance = m_tolerance;
 	options.max_iter = m_max_iter;
+	options.n_threads = m_num_threads;
 	options.n_tasks = m_task_relation->as<TaskGroup>()->get_num_tasks();
 	options.tasks_indices = m_task_relation->as<TaskGroup>()->get_tasks_indices();
 